@@ -2,6 +2,10 @@
 
 set -u
 
+# Set CONVERT_TO to build for other controllers, like:
+#   CONVERT_TO=promicro_rp2040 bin/build-keyball-all.sh
+convert_to=${CONVERT_TO:-}
+
 id=$(date "+%Y%m%d_%H%M%S")
 logdir=tmp/build_log/${id}
 
@@ -27,10 +31,13 @@ for kb in "${keyboards[@]}" ; do
     tmpmaps+=(via_Left via_Both)
   fi
   for km in "${tmpmaps[@]}" ; do
-    ( make SKIP_GIT=yes KEEP_BIN=true COLOR=false "keyball/${kb}:${km}" 2>&1 | tee "${logdir}/${kb}-${km}.log" | LANG=C.utf-8 ts "[${kb}:${km}]" ) &
+    ( make SKIP_GIT=yes KEEP_BIN=true COLOR=false ${convert_to:+CONVERT_TO=${convert_to}} "keyball/${kb}:${km}" 2>&1 | tee "${logdir}/${kb}-${km}.log" | LANG=C.utf-8 ts "[${kb}:${km}]" ) &
   done
 done
 
 wait
 
-$(dirname "$0")/hexsize.sh keyball_*.hex | tee "${logdir}/size.tsv"
+# Size limit of hexsize.sh is for ATmega32u4.
+if [ -z "${convert_to}" ] ; then
+  $(dirname "$0")/hexsize.sh keyball_*.hex | tee "${logdir}/size.tsv"
+fi
@@ -0,0 +1,73 @@
+#!/usr/bin/env python3
+"""Capture a raw frame of the trackball sensor of Keyball, and show it.
+
+The firmware should be built with KEYBALL_FRAME_CAPTURE_ENABLE and RAW_ENABLE
+or VIA_ENABLE.
+
+    python3 bin/keyball-frame.py [-d /dev/hidrawN] [-o frame.pgm]
+"""
+
+import argparse
+import sys
+
+import keyball_hid
+
+WIDTH = 36
+SIZE = WIDTH * WIDTH
+
+# darkest to brightest
+SHADES = " .:-=+*#%@"
+
+
+def capture(dev):
+    dev.send(keyball_hid.FRAME_CAPTURE)
+    frame = bytearray(SIZE)
+    received = 0
+    while received < SIZE:
+        pkt = dev.recv()
+        if pkt is None:
+            raise OSError("timeout: received %d of %d pixels" % (received, SIZE))
+        if pkt[0] != keyball_hid.PREFIX or pkt[1] != keyball_hid.FRAME_CAPTURE:
+            continue
+        off = pkt[2] | pkt[3] << 8
+        n = pkt[4]
+        if off == 0xFFFF:
+            raise OSError("capture failed: no trackball on the USB connected side")
+        frame[off:off + n] = pkt[5:5 + n]
+        received += n
+    return frame
+
+
+def show(frame, out):
+    lo, hi = min(frame), max(frame)
+    span = max(hi - lo, 1)
+    for y in range(WIDTH):
+        row = frame[y * WIDTH:(y + 1) * WIDTH]
+        # two characters per pixel to keep aspect ratio.
+        out.write("".join(SHADES[(v - lo) * (len(SHADES) - 1) // span] * 2 for v in row))
+        out.write("\n")
+    avg = sum(frame) / SIZE
+    out.write("min=%d max=%d avg=%.1f\n" % (lo, hi, avg))
+
+
+def write_pgm(frame, path):
+    with open(path, "wb") as f:
+        f.write(b"P5\n%d %d\n255\n" % (WIDTH, WIDTH))
+        f.write(bytes(frame))
+
+
+def main():
+    p = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    p.add_argument("-d", "--device", help="hidraw device (default: auto detect)")
+    p.add_argument("-o", "--output", help="write the frame as PGM image")
+    args = p.parse_args()
+
+    with keyball_hid.Device(args.device) as dev:
+        frame = capture(dev)
+    show(frame, sys.stdout)
+    if args.output:
+        write_pgm(frame, args.output)
+
+
+if __name__ == "__main__":
+    main()
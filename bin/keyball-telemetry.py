@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+"""Record telemetry of trackball sensors of Keyball as CSV.
+
+The firmware should be built with KEYBALL_TELEMETRY_ENABLE and RAW_ENABLE or
+VIA_ENABLE.  Stop recording with Ctrl-C.
+
+    python3 bin/keyball-telemetry.py [-d /dev/hidrawN] [-i 100] [-t 60] [-o log.csv]
+
+Rates (per second) are calculated from the time of the keyboard.  "this" is
+the USB connected half.  With -i as the mouse report interval (8 msec by
+default), motion is per report.
+"""
+
+import argparse
+import csv
+import struct
+import sys
+import time
+
+import keyball_hid
+
+# keyball_telemetry_t; "balls" has 2 bits of balls and 6 bits of wake.
+PACKET = struct.Struct("<BBHHHHHhhhhBBHHHH")
+FIELDS = ("seq", "balls", "time", "loops", "polls", "that_polls", "reports",
+          "this_x", "this_y", "that_x", "that_y", "squal", "that_squal",
+          "shutter", "that_shutter", "link_ok", "link_err")
+
+COLUMNS = ("host_time", "seq", "dropped", "time", "dt", "loops", "scan_hz",
+           "polls", "poll_hz", "that_polls", "that_poll_hz", "reports",
+           "report_hz", "this_x", "this_y", "that_x", "that_y", "squal",
+           "that_squal", "shutter", "that_shutter", "link_ok", "link_err",
+           "wake")
+
+# renew the request before KEYBALL_TELEMETRY_TIMEOUT of the firmware.
+RENEW_INTERVAL = 1.0
+
+
+def rate(count, dt):
+    return "%.1f" % (count * 1000.0 / dt) if dt > 0 else ""
+
+
+class Recorder:
+    """Recorder converts telemetry packets to rows of CSV."""
+
+    def __init__(self, writer):
+        self.writer = writer
+        self.last = None
+        writer.writerow(COLUMNS)
+
+    def packet(self, pkt, host_time):
+        t = dict(zip(FIELDS, PACKET.unpack_from(pkt, 2)))
+        t["wake"] = t["balls"] >> 2
+        t["balls"] &= 0x03
+        dropped, dt = 0, 0
+        if self.last is not None:
+            dropped = (t["seq"] - self.last["seq"] - 1) & 0xFF
+            dt = (t["time"] - self.last["time"]) & 0xFFFF
+        self.last = t
+        self.writer.writerow((
+            "%.3f" % host_time, t["seq"], dropped, t["time"], dt,
+            t["loops"], rate(t["loops"], dt),
+            t["polls"], rate(t["polls"], dt),
+            t["that_polls"], rate(t["that_polls"], dt),
+            t["reports"], rate(t["reports"], dt),
+            t["this_x"], t["this_y"], t["that_x"], t["that_y"],
+            t["squal"], t["that_squal"], t["shutter"], t["that_shutter"],
+            t["link_ok"], t["link_err"], t["wake"]))
+
+
+def request(dev, interval):
+    dev.send(keyball_hid.TELEMETRY, struct.pack("<H", interval))
+
+
+def record(dev, recorder, interval, duration):
+    start = time.monotonic()
+    renewed = 0.0
+    try:
+        while duration <= 0 or time.monotonic() - start < duration:
+            now = time.monotonic()
+            if now - renewed >= RENEW_INTERVAL:
+                request(dev, interval)
+                renewed = now
+            pkt = dev.recv(timeout=RENEW_INTERVAL)
+            if pkt is None:
+                continue
+            if pkt[0] != keyball_hid.PREFIX or pkt[1] != keyball_hid.TELEMETRY:
+                continue
+            recorder.packet(pkt, time.time())
+    except KeyboardInterrupt:
+        pass
+    finally:
+        request(dev, 0)
+
+
+def main():
+    p = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    p.add_argument("-d", "--device", help="hidraw device (default: auto detect)")
+    p.add_argument("-i", "--interval", type=int, default=100,
+                   help="interval of packets in msec (default: 100)")
+    p.add_argument("-t", "--duration", type=float, default=0,
+                   help="seconds to record (default: until Ctrl-C)")
+    p.add_argument("-o", "--output", help="CSV file (default: stdout)")
+    args = p.parse_args()
+    if not 1 <= args.interval <= 0xFFFF:
+        p.error("interval should be between 1 and 65535")
+
+    out = open(args.output, "w", newline="") if args.output else sys.stdout
+    try:
+        with keyball_hid.Device(args.device) as dev:
+            record(dev, Recorder(csv.writer(out)), args.interval, args.duration)
+    finally:
+        if args.output:
+            out.close()
+
+
+if __name__ == "__main__":
+    main()
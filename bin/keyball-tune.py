@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+"""Get and set parameters of Keyball at runtime over raw HID.
+
+The firmware should be built with KEYBALL_TUNING_ENABLE and RAW_ENABLE or
+VIA_ENABLE.
+
+    python3 bin/keyball-tune.py [-d /dev/hidrawN] get [NAME...]
+    python3 bin/keyball-tune.py [-d /dev/hidrawN] set [--save] NAME=VALUE...
+    python3 bin/keyball-tune.py [-d /dev/hidrawN] load [--save] FILE
+    python3 bin/keyball-tune.py [-d /dev/hidrawN] save
+    python3 bin/keyball-tune.py list
+
+Output of get can be kept to audit keyboards, and applied with load.
+"""
+
+import argparse
+import sys
+
+import keyball_hid
+
+PARAMS = {p[0]: p for p in keyball_hid.PARAMS}
+
+
+def param_name(arg):
+    if arg not in PARAMS:
+        raise argparse.ArgumentTypeError("unknown parameter: %s (see list)" % arg)
+    return arg
+
+
+def assignment(arg):
+    name, sep, value = arg.partition("=")
+    if not sep:
+        raise argparse.ArgumentTypeError("expected NAME=VALUE: %s" % arg)
+    try:
+        return param_name(name.strip()), int(value, 0)
+    except ValueError:
+        raise argparse.ArgumentTypeError("invalid value: %s" % arg)
+
+
+def read_assignments(path):
+    """Read NAME=VALUE lines written by get.  Read only parameters are
+    skipped."""
+    out = []
+    with open(path) as f:
+        for line in f:
+            line = line.split("#", 1)[0].strip()
+            if not line or "=" not in line:
+                continue
+            name, value = assignment(line)
+            if PARAMS[name][4]:
+                out.append((name, value))
+    return out
+
+
+def get(dev, names):
+    ok = True
+    for name in names or PARAMS:
+        status, value = dev.param(keyball_hid.PARAM_GET, PARAMS[name][1])
+        if status == keyball_hid.PARAM_OK:
+            print("%s=%d" % (name, value))
+        else:
+            print("# %s: %s" % (name, keyball_hid.PARAM_STATUS.get(status, status)))
+            ok = False
+    return ok
+
+
+def set_params(dev, assignments, save):
+    ok = True
+    # a profile overwrites other parameters, so it goes first.
+    for name, value in sorted(assignments, key=lambda a: a[0] != "profile"):
+        status, applied = dev.param(keyball_hid.PARAM_SET, PARAMS[name][1], value)
+        if status != keyball_hid.PARAM_OK:
+            print("%s: %s" % (name, keyball_hid.PARAM_STATUS.get(status, status)), file=sys.stderr)
+            ok = False
+            continue
+        note = "" if applied == value else "  # requested %d" % value
+        print("%s=%d%s" % (name, applied, note))
+    if save:
+        dev.param(keyball_hid.PARAM_SAVE, 0)
+    return ok
+
+
+def main():
+    p = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    p.add_argument("-d", "--device", help="hidraw device (default: auto detect)")
+    sub = p.add_subparsers(dest="command", required=True)
+    sp = sub.add_parser("get", help="print parameters as NAME=VALUE")
+    sp.add_argument("names", nargs="*", type=param_name, metavar="NAME")
+    sp = sub.add_parser("set", help="set parameters, and print applied values")
+    sp.add_argument("--save", action="store_true", help="save to EEPROM after setting")
+    sp.add_argument("assignments", nargs="+", type=assignment, metavar="NAME=VALUE")
+    sp = sub.add_parser("load", help="set parameters from output of get")
+    sp.add_argument("--save", action="store_true", help="save to EEPROM after setting")
+    sp.add_argument("file")
+    sub.add_parser("save", help="save parameters to EEPROM, same as KBC_SAVE")
+    sub.add_parser("list", help="list parameters")
+    args = p.parse_args()
+
+    if args.command == "list":
+        for name, pid, lo, hi, writable in keyball_hid.PARAMS:
+            print("%-16s %3d  %5d..%-5d%s" % (name, pid, lo, hi, "" if writable else "  read only"))
+        return 0
+
+    with keyball_hid.Device(args.device) as dev:
+        if args.command == "get":
+            ok = get(dev, args.names)
+        elif args.command == "set":
+            ok = set_params(dev, args.assignments, args.save)
+        elif args.command == "load":
+            ok = set_params(dev, read_assignments(args.file), args.save)
+        else:
+            ok = set_params(dev, [], True)
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
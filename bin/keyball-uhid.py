@@ -0,0 +1,189 @@
+#!/usr/bin/env python3
+"""Virtual Keyball on Linux uhid, a stand-in for tools over raw HID.
+
+It creates a hidraw device with the same IDs and raw HID interface as Keyball,
+and answers commands like the firmware built with KEYBALL_TUNING_ENABLE,
+KEYBALL_TELEMETRY_ENABLE and KEYBALL_FRAME_CAPTURE_ENABLE.  Parameters are
+kept in memory, and telemetry is synthetic.  It requires access to /dev/uhid
+(root, or a udev rule).
+
+    sudo python3 bin/keyball-uhid.py &
+    python3 bin/keyball-tune.py get
+"""
+
+import argparse
+import os
+import select
+import struct
+import sys
+import time
+
+import keyball_hid
+
+# linux/uhid.h
+UHID_DESTROY = 1
+UHID_START = 2
+UHID_OUTPUT = 6
+UHID_CREATE2 = 11
+UHID_INPUT2 = 12
+UHID_DATA_MAX = 4096
+# type, and the largest member uhid_create2_req.
+EVENT_SIZE = 4 + 128 + 64 + 64 + 2 + 2 + 4 * 4 + UHID_DATA_MAX
+BUS_USB = 0x03
+
+# raw HID interface of QMK: 32 bytes input and output reports.
+REPORT_DESCRIPTOR = keyball_hid.RAW_USAGE + bytes([
+    0xA1, 0x01,                                # Collection (Application)
+    0x09, 0x62, 0x15, 0x00, 0x26, 0xFF, 0x00,  # Usage, Logical Min/Max
+    0x95, keyball_hid.REPORT_SIZE, 0x75, 0x08,  # Report Count/Size
+    0x81, 0x02,                                # Input (Data, Var, Abs)
+    0x09, 0x63, 0x15, 0x00, 0x26, 0xFF, 0x00,
+    0x95, keyball_hid.REPORT_SIZE, 0x75, 0x08,
+    0x91, 0x02,                                # Output (Data, Var, Abs)
+    0xC0,                                      # End Collection
+])
+
+FRAME_WIDTH = 36
+
+# keyball_telemetry_t, and KEYBALL_TELEMETRY_TIMEOUT.
+TELEMETRY = struct.Struct("<BBHHHHHhhhhBBHHHH")
+TELEMETRY_TIMEOUT = 5.0
+
+
+class Keyball:
+    """Keyball answers raw HID packets as the firmware."""
+
+    def __init__(self):
+        self.params = {p[1]: max(p[2], 0) for p in keyball_hid.PARAMS}
+        self.params[6] = 500  # aml_timeout
+        self.params[12] = 8   # report_interval
+        self.params[14] = 2   # balls: right
+        self.saved = dict(self.params)
+        self.interval = 0
+        self.requested = 0.0
+        self.sent = 0.0
+        self.seq = 0
+
+    def receive(self, data):
+        """Return response packets for a packet from the host."""
+        if len(data) < 6 or data[0] != keyball_hid.PREFIX:
+            # unhandled, same as VIA.
+            return [b"\xff" + data[1:]]
+        command, pid = data[1], data[2]
+        if command == keyball_hid.FRAME_CAPTURE:
+            return self.frame(data)
+        if command == keyball_hid.TELEMETRY:
+            self.interval = struct.unpack_from("<H", data, 2)[0] / 1000.0
+            self.requested = time.monotonic()
+            return []
+        if command == keyball_hid.PARAM_SAVE:
+            self.saved = dict(self.params)
+            return [data]
+        if command not in (keyball_hid.PARAM_GET, keyball_hid.PARAM_SET):
+            return []
+        status = keyball_hid.PARAM_OK
+        value = struct.unpack_from("<h", data, 4)[0]
+        param = [p for p in keyball_hid.PARAMS if p[1] == pid]
+        if not param:
+            status = 1
+        elif command == keyball_hid.PARAM_SET:
+            _, _, lo, hi, writable = param[0]
+            if writable:
+                self.params[pid] = min(max(value, lo), hi)
+            else:
+                status = 2
+        if status == keyball_hid.PARAM_OK:
+            value = self.params[pid]
+        return [data[:3] + struct.pack("<Bh", status, value) + data[6:]]
+
+    def telemetry(self, now):
+        """Return a telemetry packet when it is due, and seconds until the
+        next one."""
+        if self.interval == 0 or now - self.requested >= TELEMETRY_TIMEOUT:
+            self.interval = 0
+            return [], None
+        wait = self.sent + self.interval - now
+        if wait > 0:
+            return [], wait
+        self.sent = now
+        ms = self.interval * 1000
+        # a right ball half on USB, moving slowly to the right.
+        body = TELEMETRY.pack(
+            self.seq, 0x01, int(now * 1000) & 0xFFFF, int(ms * 10),
+            int(ms), 0, int(ms / self.params[12]) if self.params[12] else int(ms),
+            int(ms), 0, 0, 0, 80, 0, 120, 0, 0, 0)
+        self.seq = (self.seq + 1) & 0xFF
+        pkt = bytes([keyball_hid.PREFIX, keyball_hid.TELEMETRY]) + body
+        return [pkt.ljust(keyball_hid.REPORT_SIZE, b"\x00")], self.interval
+
+    def frame(self, data):
+        """Return packets of a synthetic frame: a bright spot in the
+        center."""
+        c = (FRAME_WIDTH - 1) / 2
+        pixels = bytes(
+            max(0, 255 - int(((x - c) ** 2 + (y - c) ** 2) * 2))
+            for y in range(FRAME_WIDTH) for x in range(FRAME_WIDTH))
+        out = []
+        chunk = len(data) - 5
+        for off in range(0, len(pixels), chunk):
+            n = min(chunk, len(pixels) - off)
+            body = pixels[off:off + n].ljust(chunk, b"\x00")
+            out.append(data[:2] + struct.pack("<HB", off, n) + body)
+        return out
+
+
+def event(etype, payload=b""):
+    return struct.pack("<I", etype) + payload.ljust(EVENT_SIZE - 4, b"\x00")
+
+
+def create(fd, name):
+    req = struct.pack(
+        "<128s64s64sHHIIII", name.encode(), b"", b"", len(REPORT_DESCRIPTOR),
+        BUS_USB, keyball_hid.VENDOR_ID, 0x0200, 0x0001, 0)
+    os.write(fd, event(UHID_CREATE2, req + REPORT_DESCRIPTOR))
+
+
+def send_input(fd, data):
+    os.write(fd, event(UHID_INPUT2, struct.pack("<H", len(data)) + data))
+
+
+def main():
+    p = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    p.add_argument("--uhid", default="/dev/uhid", help="uhid device")
+    p.add_argument("-v", "--verbose", action="store_true", help="print packets")
+    args = p.parse_args()
+
+    kb = Keyball()
+    fd = os.open(args.uhid, os.O_RDWR)
+    create(fd, "Yowkees Keyball (virtual)")
+    try:
+        while True:
+            pkts, wait = kb.telemetry(time.monotonic())
+            for pkt in pkts:
+                send_input(fd, pkt)
+            if not select.select([fd], [], [], wait)[0]:
+                continue
+            ev = os.read(fd, EVENT_SIZE)
+            etype = struct.unpack_from("<I", ev)[0]
+            if etype == UHID_START:
+                print("started", file=sys.stderr)
+            if etype != UHID_OUTPUT:
+                continue
+            size = struct.unpack_from("<H", ev, 4 + UHID_DATA_MAX)[0]
+            data = ev[4:4 + size]
+            # hidraw passes report ID 0 at first.
+            if len(data) == keyball_hid.REPORT_SIZE + 1:
+                data = data[1:]
+            for pkt in kb.receive(data):
+                if args.verbose:
+                    print(data[:6].hex(), "->", pkt[:6].hex(), file=sys.stderr)
+                send_input(fd, pkt)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        os.write(fd, event(UHID_DESTROY))
+        os.close(fd)
+
+
+if __name__ == "__main__":
+    main()
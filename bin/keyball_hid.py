@@ -0,0 +1,134 @@
+"""Raw HID access to Keyball on Linux (hidraw).
+
+Keyball firmware handles raw HID packets which start with KEYBALL_HID_PREFIX.
+See qmk_firmware/keyboards/keyball/lib/keyball/keyball.h for the protocol.
+"""
+
+import glob
+import os
+import select
+import struct
+
+VENDOR_ID = 0x5957
+PREFIX = 0x4B  # 'K'
+REPORT_SIZE = 32
+
+# Usage Page (0xFF60) and Usage (0x61) of QMK raw HID interface.
+RAW_USAGE = bytes([0x06, 0x60, 0xFF, 0x09, 0x61])
+
+# Commands: enum keyball_hid_command.
+FRAME_CAPTURE = 0x01
+PARAM_GET = 0x02
+PARAM_SET = 0x03
+PARAM_SAVE = 0x04
+TELEMETRY = 0x05
+
+# Parameters: keyball_param_t.  (name, ID, min, max, writable).  The firmware
+# clamps values by itself, and max of cpi depends on the sensor.
+PARAMS = [
+    ("cpi", 0, 0, 159, True),
+    ("scroll_div", 1, 0, 7, True),
+    ("scroll_mode", 2, 0, 1, True),
+    ("scrollsnap_mode", 3, 0, 3, True),
+    ("kinetic_scroll", 4, 0, 6, True),
+    ("aml_enable", 5, 0, 1, True),
+    ("aml_timeout", 6, 100, 1000, True),
+    ("angle_left", 7, -30, 30, True),
+    ("angle_right", 8, -30, 30, True),
+    ("angle_snap", 9, 0, 1, True),
+    ("lift_left", 10, 0, 255, True),
+    ("lift_right", 11, 0, 255, True),
+    ("report_interval", 12, 0, 14, True),
+    ("profile", 13, 0, 3, True),
+    ("balls", 14, 0, 3, False),
+    ("click_layer", 15, 0, 1, True),
+    ("click_threshold", 16, 5, 155, True),
+    ("ball_cpi_left", 17, 0, 159, True),
+    ("ball_cpi_right", 18, 0, 159, True),
+    ("ball_sdiv_left", 19, 0, 7, True),
+    ("ball_sdiv_right", 20, 0, 7, True),
+    ("ball_mode_left", 21, 0, 2, True),
+    ("ball_mode_right", 22, 0, 2, True),
+    ("ball_xform_left", 23, 0, 7, True),
+    ("ball_xform_right", 24, 0, 7, True),
+]
+
+# Status of parameter responses: enum keyball_param_status.
+PARAM_OK = 0
+PARAM_STATUS = {
+    1: "unknown parameter",
+    2: "read only",
+    3: "not supported by the firmware",
+}
+
+
+def find_devices():
+    """Return paths of hidraw devices of raw HID interface of Keyball."""
+    found = []
+    for sys_dir in sorted(glob.glob("/sys/class/hidraw/hidraw*")):
+        try:
+            with open(os.path.join(sys_dir, "device/uevent")) as f:
+                uevent = f.read()
+            with open(os.path.join(sys_dir, "device/report_descriptor"), "rb") as f:
+                desc = f.read()
+        except OSError:
+            continue
+        hid_id = ""
+        for line in uevent.splitlines():
+            if line.startswith("HID_ID="):
+                hid_id = line[len("HID_ID="):]
+        parts = hid_id.split(":")
+        if len(parts) != 3 or int(parts[1], 16) != VENDOR_ID:
+            continue
+        if RAW_USAGE not in desc:
+            continue
+        found.append("/dev/" + os.path.basename(sys_dir))
+    return found
+
+
+class Device:
+    """Device sends and receives raw HID reports of Keyball."""
+
+    def __init__(self, path=None):
+        if path is None:
+            paths = find_devices()
+            if not paths:
+                raise OSError("Keyball raw HID interface not found")
+            path = paths[0]
+        self.path = path
+        self.fd = os.open(path, os.O_RDWR)
+
+    def close(self):
+        os.close(self.fd)
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+    def send(self, command, payload=b""):
+        data = bytes([PREFIX, command]) + bytes(payload)
+        if len(data) > REPORT_SIZE:
+            raise ValueError("payload too long")
+        # first byte is report ID, which raw HID interface doesn't use.
+        os.write(self.fd, b"\x00" + data.ljust(REPORT_SIZE, b"\x00"))
+
+    def recv(self, timeout=1.0):
+        """Return a report, or None on timeout."""
+        r, _, _ = select.select([self.fd], [], [], timeout)
+        if not r:
+            return None
+        return os.read(self.fd, REPORT_SIZE)
+
+    def param(self, command, pid, value=0):
+        """Send a parameter command, and return (status, value) of its
+        response."""
+        self.send(command, struct.pack("<BBh", pid, 0, value))
+        while True:
+            pkt = self.recv()
+            if pkt is None:
+                raise OSError("timeout: no response for parameter %d" % pid)
+            # skip responses of other requests.
+            if pkt[0] == PREFIX and pkt[1] == command and pkt[2] == pid:
+                return pkt[3], struct.unpack_from("<h", pkt, 4)[0]
@@ -0,0 +1,55 @@
+/*
+Copyright 2022 MURAOKA Taro (aka KoRoN, @kaoriya)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// Common settings for all Keyball models, when built for RP2040 with a
+// converter (CONVERT_TO=promicro_rp2040 or so).  Pin names of ProMicro are
+// translated by the converter.
+#if defined(MCU_RP)
+
+// Optical sensor: SPI0 on SCK=B1, MOSI=B2, MISO=B3 of ProMicro.
+#    ifndef SPI_DRIVER
+#        define SPI_DRIVER SPID0
+#    endif
+#    ifndef SPI_SCK_PIN
+#        define SPI_SCK_PIN B1
+#        define SPI_MOSI_PIN B2
+#        define SPI_MISO_PIN B3
+#    endif
+
+// OLED: I2C1 on SDA=D1, SCL=D0 of ProMicro.
+#    ifndef I2C_DRIVER
+#        define I2C_DRIVER I2CD1
+#    endif
+#    ifndef I2C1_SDA_PIN
+#        define I2C1_SDA_PIN D1
+#        define I2C1_SCL_PIN D0
+#    endif
+
+// 1 kHz mouse reports.
+#    ifndef KEYBALL_REPORTMOUSE_INTERVAL
+#        define KEYBALL_REPORTMOUSE_INTERVAL 1
+#    endif
+
+// Reset to the bootloader by double tapping the reset button.
+#    ifndef RP2040_BOOTLOADER_DOUBLE_TAP_RESET
+#        define RP2040_BOOTLOADER_DOUBLE_TAP_RESET
+#        define RP2040_BOOTLOADER_DOUBLE_TAP_RESET_TIMEOUT 500U
+#    endif
+
+#endif
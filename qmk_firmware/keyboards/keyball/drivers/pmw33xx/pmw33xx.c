@@ -0,0 +1,461 @@
+/*
+Copyright 2022 MURAOKA Taro (aka KoRoN, @kaoriya)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "quantum.h"
+#include "pmw33xx.h"
+
+// Parameters of models: product ID, and the register verified as the CPI.
+#if PMW33XX_MODEL == 3360
+#    define MODEL_PRODUCT_ID 0x42
+#    define MODEL_REVISION_ID 0x01
+#    define MODEL_CPI_REG pmw33xx_Config1
+// Include SROM definitions.
+#    include "srom_0x04.c"
+#    include "srom_0x81.c"
+#else
+#    define MODEL_PRODUCT_ID 0x47
+#    define MODEL_CPI_REG pmw33xx_Resolution_L
+// SROM bundled with QMK, uploaded at power up.
+#    include "drivers/sensors/pmw3389_firmware.h"
+const pmw33xx_srom_t pmw33xx_srom_3389 = {
+    .data = pmw33xx_firmware_data,
+    .len  = sizeof(pmw33xx_firmware_data),
+};
+#endif
+
+#define PMW33XX_SPI_MODE 3
+#define PMW33XX_CLOCKS 2000000
+#ifndef PMW33XX_SPI_DIVISOR
+#    ifdef __AVR__
+#        define PMW33XX_SPI_DIVISOR (F_CPU / PMW33XX_CLOCKS)
+#    else
+// about 2MHz from 125MHz peripheral clock of RP2040.
+#        define PMW33XX_SPI_DIVISOR 64
+#    endif
+#endif
+
+static const pin_t ncs_pins[] = PMW33XX_NCS_PINS;
+
+_Static_assert(PMW33XX_COUNT <= 8, "PMW33XX_NCS_PINS supports up to 8 sensors");
+
+// index of the selected sensor.  Arrays below are kept for each sensor.
+static uint8_t current = 0;
+
+static bool motion_bursting[PMW33XX_COUNT];
+
+// Shadow of configuration registers.  Values written by pmw33xx_reg_write()
+// are kept, to read them without SPI transactions and to restore them after
+// the sensor is reset.  Config2 is restored at last, after rest mode timing.
+static const uint8_t shadow_addr[] PROGMEM = {
+#if PMW33XX_MODEL == 3360
+    pmw33xx_Config1,
+#else
+    pmw33xx_Resolution_L,
+    pmw33xx_Resolution_H,
+#endif
+    pmw33xx_Angle_Tune,
+    pmw33xx_Run_Downshift,
+    pmw33xx_Rest1_Rate_Lower,
+    pmw33xx_Rest1_Rate_Upper,
+    pmw33xx_Rest1_Downshift,
+    pmw33xx_Rest2_Rate_Lower,
+    pmw33xx_Rest2_Rate_Upper,
+    pmw33xx_Rest2_Downshift,
+    pmw33xx_Rest3_Rate_Lower,
+    pmw33xx_Rest3_Rate_Upper,
+    pmw33xx_Min_SQ_Run,
+    pmw33xx_Raw_Data_Threshold,
+    pmw33xx_Config5,
+    pmw33xx_Angle_Snap,
+    pmw33xx_Lift_Config,
+    pmw33xx_LiftCutoff_Tune2,
+    pmw33xx_Config2,
+};
+
+#define SHADOW_LEN (sizeof(shadow_addr) / sizeof(shadow_addr[0]))
+
+static uint8_t  shadow_data[PMW33XX_COUNT][SHADOW_LEN];
+static uint32_t shadow_valid[PMW33XX_COUNT]; // bit mask of valid shadow_data
+
+static int8_t shadow_index(uint8_t addr) {
+    for (uint8_t i = 0; i < SHADOW_LEN; i++) {
+        if (pgm_read_byte(shadow_addr + i) == addr) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// SROM uploaded last, to upload again after reset.
+static pmw33xx_srom_t last_srom = {0};
+
+uint8_t pmw33xx_present = 0;
+
+void pmw33xx_select(uint8_t index) {
+    if (index < PMW33XX_COUNT) {
+        current = index;
+    }
+}
+
+uint8_t pmw33xx_selected(void) {
+    return current;
+}
+
+bool pmw33xx_spi_start(void) {
+    return spi_start(ncs_pins[current], false, PMW33XX_SPI_MODE, PMW33XX_SPI_DIVISOR);
+}
+
+uint8_t pmw33xx_reg_read(uint8_t addr) {
+    pmw33xx_spi_start();
+    spi_write(addr & 0x7f);
+    wait_us(160);
+    uint8_t data = spi_read();
+    wait_us(1);
+    spi_stop();
+    wait_us(19);
+    // Reset motion_bursting mode if read from a register other than motion
+    // burst register.
+    if (addr != pmw33xx_Motion_Burst) {
+        motion_bursting[current] = false;
+    }
+    return data;
+}
+
+// reg_write_raw writes a value to a register, without updating the shadow.
+static void reg_write_raw(uint8_t addr, uint8_t data) {
+    pmw33xx_spi_start();
+    spi_write(addr | 0x80);
+    spi_write(data);
+    wait_us(35);
+    spi_stop();
+    wait_us(145);
+}
+
+void pmw33xx_reg_write(uint8_t addr, uint8_t data) {
+    int8_t i = shadow_index(addr);
+    if (i >= 0) {
+        shadow_data[current][i] = data;
+        shadow_valid[current] |= (uint32_t)1 << i;
+    }
+    reg_write_raw(addr, data);
+}
+
+bool pmw33xx_reg_get(uint8_t addr, uint8_t *data) {
+    int8_t i = shadow_index(addr);
+    if (i < 0 || (shadow_valid[current] & ((uint32_t)1 << i)) == 0) {
+        return false;
+    }
+    *data = shadow_data[current][i];
+    return true;
+}
+
+uint16_t pmw33xx_cpi_get(void) {
+#if PMW33XX_MODEL == 3360
+    uint8_t cpi;
+    if (pmw33xx_reg_get(pmw33xx_Config1, &cpi)) {
+        return cpi;
+    }
+    return pmw33xx_reg_read(pmw33xx_Config1);
+#else
+    uint8_t lo, hi;
+    if (pmw33xx_reg_get(pmw33xx_Resolution_L, &lo) && pmw33xx_reg_get(pmw33xx_Resolution_H, &hi)) {
+        return lo | (uint16_t)hi << 8;
+    }
+    lo = pmw33xx_reg_read(pmw33xx_Resolution_L);
+    hi = pmw33xx_reg_read(pmw33xx_Resolution_H);
+    return lo | (uint16_t)hi << 8;
+#endif
+}
+
+void pmw33xx_cpi_set(uint16_t cpi) {
+    if (cpi > pmw33xx_MAXCPI) {
+        cpi = pmw33xx_MAXCPI;
+    }
+#if PMW33XX_MODEL == 3360
+    pmw33xx_reg_write(pmw33xx_Config1, cpi);
+#else
+    // Resolution_L should be written first.
+    pmw33xx_reg_write(pmw33xx_Resolution_L, cpi & 0xff);
+    pmw33xx_reg_write(pmw33xx_Resolution_H, cpi >> 8);
+#endif
+}
+
+void pmw33xx_quality_read(uint8_t *squal, uint16_t *shutter) {
+    *squal     = pmw33xx_reg_read(pmw33xx_SQUAL);
+    uint8_t hi = pmw33xx_reg_read(pmw33xx_Shutter_Upper);
+    *shutter   = (uint16_t)hi << 8 | pmw33xx_reg_read(pmw33xx_Shutter_Lower);
+}
+
+void pmw33xx_frame_begin(void) {
+    // disable rest modes, and start frame capture.
+    reg_write_raw(pmw33xx_Config2, 0x00);
+    reg_write_raw(pmw33xx_Frame_Capture, 0x83);
+    reg_write_raw(pmw33xx_Frame_Capture, 0xc5);
+    wait_ms(20);
+    // start burst read, which continues until pmw33xx_frame_end().
+    motion_bursting[current] = false;
+    pmw33xx_spi_start();
+    spi_write(pmw33xx_Raw_Data_Burst);
+    wait_us(160);
+}
+
+void pmw33xx_frame_read(uint8_t *buf, uint16_t len) {
+    for (uint16_t i = 0; i < len; i++) {
+        buf[i] = spi_read();
+        wait_us(15);
+    }
+}
+
+void pmw33xx_frame_end(void) {
+    spi_stop();
+    wait_us(1);
+    // the sensor requires reset to track motion again.
+    pmw33xx_recover();
+}
+
+void pmw33xx_rest_set(const pmw33xx_rest_t *r) {
+    if (r == NULL) {
+        // Config2: Rest_En = 0
+        pmw33xx_reg_write(pmw33xx_Config2, 0x00);
+        return;
+    }
+    pmw33xx_reg_write(pmw33xx_Run_Downshift, r->run_downshift);
+    pmw33xx_reg_write(pmw33xx_Rest1_Rate_Lower, r->rest1_rate & 0xff);
+    pmw33xx_reg_write(pmw33xx_Rest1_Rate_Upper, r->rest1_rate >> 8);
+    pmw33xx_reg_write(pmw33xx_Rest1_Downshift, r->rest1_downshift);
+    pmw33xx_reg_write(pmw33xx_Rest2_Rate_Lower, r->rest2_rate & 0xff);
+    pmw33xx_reg_write(pmw33xx_Rest2_Rate_Upper, r->rest2_rate >> 8);
+    pmw33xx_reg_write(pmw33xx_Rest2_Downshift, r->rest2_downshift);
+    pmw33xx_reg_write(pmw33xx_Rest3_Rate_Lower, r->rest3_rate & 0xff);
+    pmw33xx_reg_write(pmw33xx_Rest3_Rate_Upper, r->rest3_rate >> 8);
+    // Config2: Rest_En = 1
+    pmw33xx_reg_write(pmw33xx_Config2, 0x20);
+}
+
+bool pmw33xx_lift_cal_start(void) {
+    if (pmw33xx_srom_id == 0) {
+        return false;
+    }
+#ifdef PMW33XX_LIFT_CAL_TIMEOUT
+    pmw33xx_reg_write(pmw33xx_LiftCutoff_Tune_Timeout, PMW33XX_LIFT_CAL_TIMEOUT);
+#endif
+#ifdef PMW33XX_LIFT_CAL_MIN_LENGTH
+    pmw33xx_reg_write(pmw33xx_LiftCutoff_Tune_Min_Length, PMW33XX_LIFT_CAL_MIN_LENGTH);
+#endif
+    // use the default cutoff while calibrating, then start calibration.
+    pmw33xx_reg_write(pmw33xx_LiftCutoff_Tune2, 0x00);
+    pmw33xx_reg_write(pmw33xx_LiftCutoff_Tune3, 0x80);
+    return true;
+}
+
+int16_t pmw33xx_lift_cal_poll(void) {
+    // bit 7 of LiftCutoff_Tune3 is kept while calibrating.
+    if (pmw33xx_reg_read(pmw33xx_LiftCutoff_Tune3) & 0x80) {
+        return -1;
+    }
+    return pmw33xx_reg_read(pmw33xx_LiftCutoff_Tune1) & 0x7f;
+}
+
+void pmw33xx_lift_cutoff_set(uint8_t value) {
+    // bit 7 of LiftCutoff_Tune2 enables the calibrated value.
+    pmw33xx_reg_write(pmw33xx_LiftCutoff_Tune2, value == 0 ? 0x00 : (value & 0x7f) | 0x80);
+}
+
+void pmw33xx_angle_tune_set(int8_t angle) {
+    if (angle > pmw33xx_MAXANGLE) {
+        angle = pmw33xx_MAXANGLE;
+    } else if (angle < -pmw33xx_MAXANGLE) {
+        angle = -pmw33xx_MAXANGLE;
+    }
+    pmw33xx_reg_write(pmw33xx_Angle_Tune, (uint8_t)angle);
+}
+
+void pmw33xx_angle_snap_set(bool enable) {
+    pmw33xx_reg_write(pmw33xx_Angle_Snap, enable ? 0x80 : 0x00);
+}
+
+static uint32_t pmw33xx_timer      = 0;
+static uint32_t pmw33xx_scan_count = 0;
+static uint32_t pmw33xx_last_count = 0;
+
+void pmw33xx_scan_perf_task(void) {
+    pmw33xx_scan_count++;
+    uint32_t now = timer_read32();
+    if (TIMER_DIFF_32(now, pmw33xx_timer) > 1000) {
+#if defined(CONSOLE_ENABLE)
+        dprintf("pmw33xx scan frequency: %lu\n", pmw33xx_scan_count);
+#endif
+        pmw33xx_last_count = pmw33xx_scan_count;
+        pmw33xx_scan_count = 0;
+        pmw33xx_timer      = now;
+    }
+}
+
+uint32_t pmw33xx_scan_rate_get(void) {
+    return pmw33xx_last_count;
+}
+
+bool pmw33xx_motion_read(pmw33xx_motion_t *d) {
+#ifdef DEBUG_PMW33XX_SCAN_RATE
+    pmw33xx_scan_perf_task();
+#endif
+    uint8_t mot = pmw33xx_reg_read(pmw33xx_Motion);
+    if ((mot & 0x88) != 0x80) {
+        return false;
+    }
+    d->x = pmw33xx_reg_read(pmw33xx_Delta_X_L);
+    d->x |= pmw33xx_reg_read(pmw33xx_Delta_X_H) << 8;
+    d->y = pmw33xx_reg_read(pmw33xx_Delta_Y_L);
+    d->y |= pmw33xx_reg_read(pmw33xx_Delta_Y_H) << 8;
+    return true;
+}
+
+bool pmw33xx_motion_burst(pmw33xx_motion_t *d) {
+#ifdef DEBUG_PMW33XX_SCAN_RATE
+    pmw33xx_scan_perf_task();
+#endif
+    // Start motion burst if motion burst mode is not started.
+    if (!motion_bursting[current]) {
+        pmw33xx_reg_write(pmw33xx_Motion_Burst, 0);
+        motion_bursting[current] = true;
+    }
+
+    pmw33xx_spi_start();
+    spi_write(pmw33xx_Motion_Burst);
+    wait_us(35);
+    uint8_t mot = spi_read();
+    spi_read(); // skip Observation
+    d->x = spi_read();
+    d->x |= spi_read() << 8;
+    d->y = spi_read();
+    d->y |= spi_read() << 8;
+    spi_stop();
+    // Required NCS in 500ns after motion burst.
+    wait_us(1);
+    return (mot & 0x80) != 0;
+}
+
+// power_up resets the sensor, and checks its product ID.
+static bool power_up(void) {
+    // reboot
+    pmw33xx_spi_start();
+    reg_write_raw(pmw33xx_Power_Up_Reset, 0x5a);
+    wait_ms(50);
+    motion_bursting[current] = false;
+    // read five registers of motion and discard those values
+    pmw33xx_reg_read(pmw33xx_Motion);
+    pmw33xx_reg_read(pmw33xx_Delta_X_L);
+    pmw33xx_reg_read(pmw33xx_Delta_X_H);
+    pmw33xx_reg_read(pmw33xx_Delta_Y_L);
+    pmw33xx_reg_read(pmw33xx_Delta_Y_H);
+    // configuration
+    reg_write_raw(pmw33xx_Config2, 0x00);
+    // check product ID and revision ID
+    uint8_t pid = pmw33xx_reg_read(pmw33xx_Product_ID);
+    uint8_t rev = pmw33xx_reg_read(pmw33xx_Revision_ID);
+    spi_stop();
+#ifdef MODEL_REVISION_ID
+    return pid == MODEL_PRODUCT_ID && rev == MODEL_REVISION_ID;
+#else
+    return pid == MODEL_PRODUCT_ID;
+#endif
+}
+
+bool pmw33xx_init(void) {
+    spi_init();
+    // deselect all sensors on the bus, before talking to one of them.
+    for (uint8_t i = 0; i < PMW33XX_COUNT; i++) {
+        setPinOutput(ncs_pins[i]);
+        writePinHigh(ncs_pins[i]);
+    }
+    shadow_valid[current] = 0;
+    last_srom             = (pmw33xx_srom_t){0};
+    bool ok               = power_up();
+#ifdef PMW33XX_LIFT_CONFIG
+    pmw33xx_reg_write(pmw33xx_Lift_Config, PMW33XX_LIFT_CONFIG);
+#endif
+    if (ok) {
+        pmw33xx_present |= 1 << current;
+    } else {
+        pmw33xx_present &= ~(1 << current);
+    }
+    return ok;
+}
+
+// Registers compared with the shadow by pmw33xx_verify().  CPI alone may equal
+// its reset value, so Angle_Tune and Config2 (Rest_En) which differ from reset
+// values by other settings are compared too.
+static const uint8_t verify_addr[] PROGMEM = {
+    MODEL_CPI_REG,
+    pmw33xx_Angle_Tune,
+    pmw33xx_Config2,
+};
+
+bool pmw33xx_verify(void) {
+    for (uint8_t i = 0; i < sizeof(verify_addr); i++) {
+        uint8_t addr = pgm_read_byte(verify_addr + i);
+        uint8_t v;
+        if (pmw33xx_reg_get(addr, &v) && pmw33xx_reg_read(addr) != v) {
+            return false;
+        }
+    }
+    if (pmw33xx_srom_id != 0 && pmw33xx_reg_read(pmw33xx_SROM_ID) != pmw33xx_srom_id) {
+        return false;
+    }
+    return true;
+}
+
+bool pmw33xx_recover(void) {
+    if (!power_up()) {
+        return false;
+    }
+    if (last_srom.data != NULL) {
+        pmw33xx_srom_upload(last_srom);
+    }
+    // restore all configurations in one pass.
+    for (uint8_t i = 0; i < SHADOW_LEN; i++) {
+        if (shadow_valid[current] & ((uint32_t)1 << i)) {
+            reg_write_raw(pgm_read_byte(shadow_addr + i), shadow_data[current][i]);
+        }
+    }
+    return true;
+}
+
+uint8_t pmw33xx_srom_id = 0;
+
+void pmw33xx_srom_upload(pmw33xx_srom_t srom) {
+    last_srom = srom;
+    reg_write_raw(pmw33xx_Config2, 0x00);
+    reg_write_raw(pmw33xx_SROM_Enable, 0x1d);
+    wait_us(10);
+    reg_write_raw(pmw33xx_SROM_Enable, 0x18);
+
+    // SROM upload (download for PMW33XX) with burst mode
+    pmw33xx_spi_start();
+    spi_write(pmw33xx_SROM_Load_Burst | 0x80);
+    wait_us(15);
+    for (size_t i = 0; i < srom.len; i++) {
+        spi_write(pgm_read_byte(srom.data + i));
+        wait_us(15);
+    }
+    spi_stop();
+    wait_us(200);
+
+    pmw33xx_srom_id = pmw33xx_reg_read(pmw33xx_SROM_ID);
+    reg_write_raw(pmw33xx_Config2, 0x00);
+    wait_ms(10);
+}
@@ -0,0 +1,315 @@
+/*
+Copyright 2022 MURAOKA Taro (aka KoRoN, @kaoriya)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include "spi_master.h"
+
+//////////////////////////////////////////////////////////////////////////////
+// Configurations
+
+/// PMW33XX_MODEL selects the sensor: 3360 (PMW3360, default) or 3389
+/// (PMW3389).  They share this driver, and differ in product ID, CPI range
+/// and CPI registers.
+#ifndef PMW33XX_MODEL
+#    define PMW33XX_MODEL 3360
+#endif
+
+#if PMW33XX_MODEL != 3360 && PMW33XX_MODEL != 3389
+#    error Invalid value for PMW33XX_MODEL. Please choose 3360 or 3389.
+#endif
+
+#ifndef PMW33XX_NCS_PIN
+#    ifdef PMW3360_NCS_PIN
+#        define PMW33XX_NCS_PIN PMW3360_NCS_PIN
+#    else
+#        define PMW33XX_NCS_PIN B6
+#    endif
+#endif
+
+/// PMW33XX_NCS_PINS lists NCS pins of sensors sharing one SPI bus, up to 8.
+/// It is { PMW33XX_NCS_PIN } by default.  Select a sensor with
+/// pmw33xx_select() before other functions.
+//#define PMW33XX_NCS_PINS { B6, B5 }
+#ifndef PMW33XX_NCS_PINS
+#    define PMW33XX_NCS_PINS { PMW33XX_NCS_PIN }
+#endif
+
+/// PMW33XX_COUNT is count of sensors in PMW33XX_NCS_PINS.
+#define PMW33XX_COUNT (sizeof((pin_t[])PMW33XX_NCS_PINS) / sizeof(pin_t))
+
+/// DEBUG_PMW33XX_SCAN_RATE enables scan performance counter.
+/// It records scan count in a last second and enables pmw33xx_scan_rate_get().
+/// Additionally, it will be logged automatically when defined CONSOLE_ENABLE
+/// and `debug_enable = true`.
+//#define DEBUG_PMW33XX_SCAN_RATE
+
+/// PMW33XX_LIFT_CONFIG is written to Lift_Config register at initialization
+/// when defined.  0x02 for 2mm (default of the sensor) or 0x03 for 3mm of
+/// lift detection height.
+//#define PMW33XX_LIFT_CONFIG 0x02
+
+/// PMW33XX_LIFT_CAL_TIMEOUT and PMW33XX_LIFT_CAL_MIN_LENGTH are written to
+/// LiftCutoff_Tune_Timeout and LiftCutoff_Tune_Min_Length registers as is,
+/// before lift cutoff calibration when defined.  Otherwise defaults of the
+/// sensor are used.
+//#define PMW33XX_LIFT_CAL_TIMEOUT
+//#define PMW33XX_LIFT_CAL_MIN_LENGTH
+
+//////////////////////////////////////////////////////////////////////////////
+// Types
+
+typedef struct {
+    const uint8_t *data;
+    size_t         len;
+} pmw33xx_srom_t;
+
+typedef struct {
+    int16_t x;
+    int16_t y;
+} pmw33xx_motion_t;
+
+// pmw33xx_rest_t is timing of rest modes, in raw values of registers.
+typedef struct {
+    uint8_t  run_downshift;   // Run_Downshift: Run to Rest1 in 10ms
+    uint16_t rest1_rate;      // Rest1_Rate: frame period - 1 in ms
+    uint8_t  rest1_downshift; // Rest1_Downshift: Rest1 to Rest2 in 320 frames
+    uint16_t rest2_rate;      // Rest2_Rate: frame period - 1 in ms
+    uint8_t  rest2_downshift; // Rest2_Downshift: Rest2 to Rest3 in 32 frames
+    uint16_t rest3_rate;      // Rest3_Rate: frame period - 1 in ms
+} pmw33xx_rest_t;
+
+typedef enum {
+    pmw33xx_Product_ID                 = 0x00,
+    pmw33xx_Revision_ID                = 0x01,
+    pmw33xx_Motion                     = 0x02,
+    pmw33xx_Delta_X_L                  = 0x03,
+    pmw33xx_Delta_X_H                  = 0x04,
+    pmw33xx_Delta_Y_L                  = 0x05,
+    pmw33xx_Delta_Y_H                  = 0x06,
+    pmw33xx_SQUAL                      = 0x07,
+    pmw33xx_Raw_Data_Sum               = 0x08,
+    pmw33xx_Maximum_Raw_data           = 0x09,
+    pmw33xx_Minimum_Raw_data           = 0x0A,
+    pmw33xx_Shutter_Lower              = 0x0B,
+    pmw33xx_Shutter_Upper              = 0x0C,
+    pmw33xx_Control                    = 0x0D,
+#if PMW33XX_MODEL == 3360
+    pmw33xx_Config1                    = 0x0F,
+#else
+    pmw33xx_Resolution_L               = 0x0E,
+    pmw33xx_Resolution_H               = 0x0F,
+#endif
+    pmw33xx_Config2                    = 0x10,
+    pmw33xx_Angle_Tune                 = 0x11,
+    pmw33xx_Frame_Capture              = 0x12,
+    pmw33xx_SROM_Enable                = 0x13,
+    pmw33xx_Run_Downshift              = 0x14,
+    pmw33xx_Rest1_Rate_Lower           = 0x15,
+    pmw33xx_Rest1_Rate_Upper           = 0x16,
+    pmw33xx_Rest1_Downshift            = 0x17,
+    pmw33xx_Rest2_Rate_Lower           = 0x18,
+    pmw33xx_Rest2_Rate_Upper           = 0x19,
+    pmw33xx_Rest2_Downshift            = 0x1A,
+    pmw33xx_Rest3_Rate_Lower           = 0x1B,
+    pmw33xx_Rest3_Rate_Upper           = 0x1C,
+    pmw33xx_Observation                = 0x24,
+    pmw33xx_Data_Out_Lower             = 0x25,
+    pmw33xx_Data_Out_Upper             = 0x26,
+    pmw33xx_Raw_Data_Dump              = 0x29,
+    pmw33xx_SROM_ID                    = 0x2A,
+    pmw33xx_Min_SQ_Run                 = 0x2B,
+    pmw33xx_Raw_Data_Threshold         = 0x2C,
+    pmw33xx_Config5                    = 0x2F,
+    pmw33xx_Power_Up_Reset             = 0x3A,
+    pmw33xx_Shutdown                   = 0x3B,
+    pmw33xx_Inverse_Product_ID         = 0x3F,
+    pmw33xx_LiftCutoff_Tune3           = 0x41,
+    pmw33xx_Angle_Snap                 = 0x42,
+    pmw33xx_LiftCutoff_Tune1           = 0x4A,
+    pmw33xx_Motion_Burst               = 0x50,
+    pmw33xx_LiftCutoff_Tune_Timeout    = 0x58,
+    pmw33xx_LiftCutoff_Tune_Min_Length = 0x5A,
+    pmw33xx_SROM_Load_Burst            = 0x62,
+    pmw33xx_Lift_Config                = 0x63,
+    pmw33xx_Raw_Data_Burst             = 0x64,
+    pmw33xx_LiftCutoff_Tune2           = 0x65,
+} pmw33xx_reg_t;
+
+enum {
+#if PMW33XX_MODEL == 3360
+    pmw33xx_MAXCPI   = 0x77, // = 119: 12000 CPI in 100 CPI steps
+#else
+    pmw33xx_MAXCPI   = 0x13F, // = 319: 16000 CPI in 50 CPI steps
+#endif
+    pmw33xx_MAXANGLE = 30, // range of Angle_Tune: -30 ~ 30 degrees
+
+    pmw33xx_FRAME_WIDTH = 36,   // raw frame: 36 x 36 pixels
+    pmw33xx_FRAME_SIZE  = 1296,
+};
+
+//////////////////////////////////////////////////////////////////////////////
+// Exported values (touch carefully)
+
+/// SROM ID, last uploaded. 0 means not uploaded yet.
+extern uint8_t pmw33xx_srom_id;
+
+/// Bit mask of sensors which responded to pmw33xx_init(), by index.
+extern uint8_t pmw33xx_present;
+
+#if PMW33XX_MODEL == 3360
+/// SROM 0x04 of PMW3360
+extern const pmw33xx_srom_t pmw33xx_srom_0x04;
+/// SROM 0x81 of PMW3360
+extern const pmw33xx_srom_t pmw33xx_srom_0x81;
+#else
+/// SROM of PMW3389, from drivers/sensors/pmw3389_firmware.h of QMK.
+extern const pmw33xx_srom_t pmw33xx_srom_3389;
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+// Top level API
+
+/// pmw33xx_select selects a sensor by index of PMW33XX_NCS_PINS, for all
+/// following functions.  The first sensor (0) is selected at first.
+void pmw33xx_select(uint8_t index);
+
+/// pmw33xx_selected returns index of the selected sensor.
+uint8_t pmw33xx_selected(void);
+
+/// pmw33xx_init initializes the sensor module: the selected one.
+/// It will return true when succeeded, otherwise false.
+bool pmw33xx_init(void);
+
+void pmw33xx_srom_upload(pmw33xx_srom_t srom);
+
+/// pmw33xx_verify checks the sensor keeps the configuration, by reading
+/// the CPI register and SROM_ID.  It returns false when the sensor seems to have been
+/// reset: by ESD or brown-out for example.
+bool pmw33xx_verify(void);
+
+/// pmw33xx_recover resets the sensor, uploads the last SROM again, and
+/// restores all configuration registers written by pmw33xx_reg_write() in one
+/// pass.  It returns false when the sensor doesn't respond.
+bool pmw33xx_recover(void);
+
+/// pmw33xx_motion_read gets a motion data by Motion register.
+/// This requires to write a dummy data to pmw33xx_Motion register
+/// just before.
+bool pmw33xx_motion_read(pmw33xx_motion_t *d);
+
+/// pmw33xx_motion_burst gets a motion data by Motion_Burst command.
+/// This requires to write a dummy data to pmw33xx_Motion_Burst register
+/// just before.
+/// It returns MOT flag: false when no motion has occurred.
+bool pmw33xx_motion_burst(pmw33xx_motion_t *d);
+
+/// pmw33xx_scan_rate_get gets count of scan in a last second.
+/// This works only when DEBUG_PMW33XX_SCAN_RATE is defined.
+uint32_t pmw33xx_scan_rate_get(void);
+
+/// pmw33xx_cpi_get gets CPI value of the sensor.  It is read from the shadow
+/// of CPI registers (Config1 or Resolution) without SPI transaction, when
+/// written before.
+uint16_t pmw33xx_cpi_get(void);
+
+/// pmw33xx_cpi_set sets CPI value of the sensor.  Valid values are between 0
+/// and pmw33xx_MAXCPI, and the actual CPI is (cpi + 1) * 100 for PMW3360, or
+/// (cpi + 1) * 50 for PMW3389.
+void pmw33xx_cpi_set(uint16_t cpi);
+
+/// pmw33xx_quality_read reads SQUAL (surface quality: count of features in
+/// the frame) and Shutter (exposure, longer on darker surface) registers.  It
+/// leaves motion burst mode.
+void pmw33xx_quality_read(uint8_t *squal, uint16_t *shutter);
+
+/// pmw33xx_frame_begin starts capture of a raw frame, and starts burst read of
+/// its pixels.  Read all pmw33xx_FRAME_SIZE pixels with pmw33xx_frame_read()
+/// then call pmw33xx_frame_end().  The sensor doesn't track motion meanwhile,
+/// and nothing else should access SPI.
+void pmw33xx_frame_begin(void);
+
+/// pmw33xx_frame_read reads next len pixels of the raw frame to buf.  Pixels
+/// are ordered from the first row, and each of them has 8 bits value.
+void pmw33xx_frame_read(uint8_t *buf, uint16_t len);
+
+/// pmw33xx_frame_end finishes capture of a raw frame, and returns the sensor
+/// to normal tracking with pmw33xx_recover().
+void pmw33xx_frame_end(void);
+
+/// pmw33xx_rest_set enables rest modes of the sensor with timing r, or
+/// disables rest modes when r is NULL.  The sensor lowers its frame rate step
+/// by step in rest modes, while no motion is detected.
+void pmw33xx_rest_set(const pmw33xx_rest_t *r);
+
+/// pmw33xx_lift_cal_start starts lift cutoff calibration of the sensor.
+/// Move the sensor on the surface (roll the trackball) until
+/// pmw33xx_lift_cal_poll() finishes.  This requires SROM uploaded, and returns
+/// false when it isn't.
+bool pmw33xx_lift_cal_start(void);
+
+/// pmw33xx_lift_cal_poll checks the progress of lift cutoff calibration.
+/// It returns -1 while calibrating, 0 when failed, or the calibrated value to
+/// be passed to pmw33xx_lift_cutoff_set().
+int16_t pmw33xx_lift_cal_poll(void);
+
+/// pmw33xx_lift_cutoff_set applies a calibrated lift cutoff value.  0 makes
+/// the sensor use its default lift cutoff.
+void pmw33xx_lift_cutoff_set(uint8_t value);
+
+/// pmw33xx_angle_tune_set rotates motion data by angle in degrees: clockwise
+/// for positive values.  Valid values are between -30 and 30.
+void pmw33xx_angle_tune_set(int8_t angle);
+
+/// pmw33xx_angle_snap_set enables or disables angle snapping, which snaps
+/// nearly horizontal or vertical motion to the axis.
+void pmw33xx_angle_snap_set(bool enable);
+
+//////////////////////////////////////////////////////////////////////////////
+// Register operations
+
+/// pmw33xx_reg_write writes a value to a register.  Values of configuration
+/// registers are kept in the shadow, see pmw33xx_reg_get().
+void pmw33xx_reg_write(uint8_t addr, uint8_t data);
+
+/// pmw33xx_reg_get gets a value of a configuration register from the shadow,
+/// without SPI transaction.  It returns false when the register is not
+/// shadowed or has not been written yet.
+bool pmw33xx_reg_get(uint8_t addr, uint8_t *data);
+
+/// pmw33xx_reg_read reads a value from a register.
+uint8_t pmw33xx_reg_read(uint8_t addr);
+
+//////////////////////////////////////////////////////////////////////////////
+// SPI operations
+
+bool pmw33xx_spi_start(void);
+
+void inline pmw33xx_spi_stop(void) {
+    spi_stop();
+}
+
+/// \deprecated use pmw33xx_reg_write() instead of this.
+spi_status_t inline pmw33xx_spi_write(uint8_t data) {
+    return spi_write(data);
+}
+
+/// \deprecated use pmw33xx_reg_read() instead of this.
+spi_status_t inline pmw33xx_spi_read(void) {
+    return spi_read();
+}
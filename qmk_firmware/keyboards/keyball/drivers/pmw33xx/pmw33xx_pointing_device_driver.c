@@ -16,20 +16,20 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "pointing_device.h"
-#include "pmw3360.h"
+#include "pmw33xx.h"
 
-bool pmw3360_has = false;
+bool pmw33xx_has = false;
 
 void pointing_device_driver_init(void) {
-    pmw3360_has = pmw3360_init();
-    pmw3360_reg_write(pmw3360_Motion_Burst, 0);
+    pmw33xx_has = pmw33xx_init();
+    pmw33xx_reg_write(pmw33xx_Motion_Burst, 0);
 }
 
 #define constrain_hid(amt) ((amt) < -127 ? -127 : ((amt) > 127 ? 127 : (amt)))
 
 report_mouse_t pointing_device_driver_get_report(report_mouse_t mouse_report) {
-    pmw3360_motion_t d = {0};
-    if (pmw3360_has && pmw3360_motion_burst(&d)) {
+    pmw33xx_motion_t d = {0};
+    if (pmw33xx_has && pmw33xx_motion_burst(&d)) {
         mouse_report.x = constrain_hid(d.y);
         mouse_report.y = constrain_hid(d.x);
     }
@@ -37,15 +37,15 @@ report_mouse_t pointing_device_driver_get_report(report_mouse_t mouse_report) {
 }
 
 uint16_t pointing_device_driver_get_cpi(void) {
-    if (!pmw3360_has) {
+    if (!pmw33xx_has) {
         return 0;
     }
-    return pmw3360_cpi_get();
+    return pmw33xx_cpi_get();
 }
 
 void pointing_device_driver_set_cpi(uint16_t cpi) {
-    if (!pmw3360_has) {
+    if (!pmw33xx_has) {
         return;
     }
-    pmw3360_cpi_set(cpi);
+    pmw33xx_cpi_set(cpi);
 }
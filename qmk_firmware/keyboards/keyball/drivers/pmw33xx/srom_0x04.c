@@ -257,7 +257,7 @@ static const uint8_t srom_data_0x04[] PROGMEM = {
     0xC2, 0xE7, 0x4C, 0x1A, 0x97, 0x8D, 0x98, 0xB2, 0xC7, 0x0C, 0x59, 0x28, 0xF3, 0x9B
 };
 
-const pmw3360_srom_t pmw3360_srom_0x04 = {
+const pmw33xx_srom_t pmw33xx_srom_0x04 = {
     .data = srom_data_0x04,
     .len = sizeof(srom_data_0x04),
 };
@@ -257,7 +257,7 @@ static const uint8_t srom_data_0x81[] PROGMEM = {
     0x57, 0x0D, 0x98, 0x93, 0xA4, 0xAB, 0xB5, 0xC9, 0xF1, 0x60, 0x7B, 0x17, 0xC8, 0x4A
 };
 
-const pmw3360_srom_t pmw3360_srom_0x81 = {
+const pmw33xx_srom_t pmw33xx_srom_0x81 = {
     .data = srom_data_0x81,
     .len = sizeof(srom_data_0x81),
 };
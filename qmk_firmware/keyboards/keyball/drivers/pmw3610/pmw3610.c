@@ -0,0 +1,164 @@
+/*
+Copyright 2022 MURAOKA Taro (aka KoRoN, @kaoriya)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "quantum.h"
+#include "pmw3610.h"
+
+#define PMW3610_SPI_MODE 3
+#define PMW3610_CLOCKS 2000000
+#ifndef PMW3610_SPI_DIVISOR
+#    ifdef __AVR__
+#        define PMW3610_SPI_DIVISOR (F_CPU / PMW3610_CLOCKS)
+#    else
+// about 2MHz from 125MHz peripheral clock of RP2040.
+#        define PMW3610_SPI_DIVISOR 64
+#    endif
+#endif
+
+// CPI written last, to restore it after reset.  0xff means not written yet.
+static uint8_t last_cpi = 0xff;
+
+static bool spi_start_3610(void) {
+    return spi_start(PMW3610_NCS_PIN, false, PMW3610_SPI_MODE, PMW3610_SPI_DIVISOR);
+}
+
+uint8_t pmw3610_reg_read(uint8_t addr) {
+    spi_start_3610();
+    spi_write(addr & 0x7f);
+    wait_us(4);
+    uint8_t data = spi_read();
+    spi_stop();
+    wait_us(2);
+    return data;
+}
+
+static void reg_write_raw(uint8_t addr, uint8_t data) {
+    spi_start_3610();
+    spi_write(addr | 0x80);
+    spi_write(data);
+    spi_stop();
+    wait_us(30);
+}
+
+void pmw3610_reg_write(uint8_t addr, uint8_t data) {
+    reg_write_raw(pmw3610_SPI_Clk_On_Req, 0xba);
+    wait_us(300);
+    reg_write_raw(addr, data);
+    reg_write_raw(pmw3610_SPI_Clk_On_Req, 0xb5);
+}
+
+static void res_step_write(uint8_t cpi) {
+    reg_write_raw(pmw3610_SPI_Clk_On_Req, 0xba);
+    wait_us(300);
+    // Res_Step is in page 1.
+    reg_write_raw(pmw3610_SPI_Page0, 0xff);
+    reg_write_raw(pmw3610_Res_Step, cpi + 1);
+    reg_write_raw(pmw3610_SPI_Page1, 0x00);
+    reg_write_raw(pmw3610_SPI_Clk_On_Req, 0xb5);
+}
+
+static uint8_t res_step_read(void) {
+    reg_write_raw(pmw3610_SPI_Clk_On_Req, 0xba);
+    wait_us(300);
+    reg_write_raw(pmw3610_SPI_Page0, 0xff);
+    uint8_t v = pmw3610_reg_read(pmw3610_Res_Step);
+    reg_write_raw(pmw3610_SPI_Page1, 0x00);
+    reg_write_raw(pmw3610_SPI_Clk_On_Req, 0xb5);
+    return v;
+}
+
+uint8_t pmw3610_cpi_get(void) {
+    return last_cpi == 0xff ? 0 : last_cpi;
+}
+
+void pmw3610_cpi_set(uint8_t cpi) {
+    if (cpi > pmw3610_MAXCPI) {
+        cpi = pmw3610_MAXCPI;
+    }
+    last_cpi = cpi;
+    res_step_write(cpi);
+}
+
+void pmw3610_quality_read(uint8_t *squal, uint16_t *shutter) {
+    *squal     = pmw3610_reg_read(pmw3610_SQUAL);
+    uint8_t hi = pmw3610_reg_read(pmw3610_Shutter_Higher);
+    *shutter   = (uint16_t)hi << 8 | pmw3610_reg_read(pmw3610_Shutter_Lower);
+}
+
+// sign_extend_12 converts 12 bits two's complement to int16_t.
+static inline int16_t sign_extend_12(uint16_t v) {
+    return (v & 0x800) ? (int16_t)(v | 0xf000) : (int16_t)v;
+}
+
+bool pmw3610_motion_burst(pmw3610_motion_t *d) {
+    spi_start_3610();
+    spi_write(pmw3610_Burst_Read);
+    wait_us(4);
+    uint8_t mot = spi_read();
+    uint8_t xl  = spi_read();
+    uint8_t yl  = spi_read();
+    uint8_t xyh = spi_read();
+    spi_stop();
+    wait_us(2);
+    if ((mot & 0x80) == 0) {
+        return false;
+    }
+    d->x = sign_extend_12(xl | (uint16_t)(xyh & 0xf0) << 4);
+    d->y = sign_extend_12(yl | (uint16_t)(xyh & 0x0f) << 8);
+    return true;
+}
+
+// power_up resets the sensor, and checks its product ID and self test.
+static bool power_up(void) {
+    reg_write_raw(pmw3610_Power_Up_Reset, 0x5a);
+    wait_ms(50);
+    // self test: all bits of Observation are set in 10ms.
+    pmw3610_reg_write(pmw3610_Observation, 0x00);
+    wait_ms(10);
+    uint8_t obs = pmw3610_reg_read(pmw3610_Observation);
+    // read motion registers and discard those values
+    pmw3610_reg_read(pmw3610_Motion);
+    pmw3610_reg_read(pmw3610_Delta_X_L);
+    pmw3610_reg_read(pmw3610_Delta_Y_L);
+    pmw3610_reg_read(pmw3610_Delta_XY_H);
+    uint8_t pid = pmw3610_reg_read(pmw3610_Product_ID);
+    return pid == 0x3e && (obs & 0x0f) == 0x0f;
+}
+
+bool pmw3610_init(void) {
+    spi_init();
+    setPinOutput(PMW3610_NCS_PIN);
+    last_cpi = 0xff;
+    return power_up();
+}
+
+bool pmw3610_verify(void) {
+    if (last_cpi != 0xff && res_step_read() != last_cpi + 1) {
+        return false;
+    }
+    return true;
+}
+
+bool pmw3610_recover(void) {
+    if (!power_up()) {
+        return false;
+    }
+    if (last_cpi != 0xff) {
+        res_step_write(last_cpi);
+    }
+    return true;
+}
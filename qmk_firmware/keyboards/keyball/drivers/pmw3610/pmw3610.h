@@ -0,0 +1,113 @@
+/*
+Copyright 2022 MURAOKA Taro (aka KoRoN, @kaoriya)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include "spi_master.h"
+
+// PMW3610 has 3-wire SPI (SDIO).  Connect both of MOSI and MISO to SDIO, MOSI
+// through a resistor (1k ohm or so), to use it with SPI master.
+
+//////////////////////////////////////////////////////////////////////////////
+// Configurations
+
+#ifndef PMW3610_NCS_PIN
+#    define PMW3610_NCS_PIN B6
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+// Types
+
+typedef struct {
+    int16_t x;
+    int16_t y;
+} pmw3610_motion_t;
+
+typedef enum {
+    pmw3610_Product_ID      = 0x00,
+    pmw3610_Revision_ID     = 0x01,
+    pmw3610_Motion          = 0x02,
+    pmw3610_Delta_X_L       = 0x03,
+    pmw3610_Delta_Y_L       = 0x04,
+    pmw3610_Delta_XY_H      = 0x05,
+    pmw3610_SQUAL           = 0x06,
+    pmw3610_Shutter_Higher  = 0x07,
+    pmw3610_Shutter_Lower   = 0x08,
+    pmw3610_Performance     = 0x11,
+    pmw3610_Burst_Read      = 0x12,
+    pmw3610_Run_Downshift   = 0x1B,
+    pmw3610_Rest1_Rate      = 0x1C,
+    pmw3610_Rest1_Downshift = 0x1D,
+    pmw3610_Rest2_Rate      = 0x1E,
+    pmw3610_Rest2_Downshift = 0x1F,
+    pmw3610_Rest3_Rate      = 0x20,
+    pmw3610_Observation     = 0x2D,
+    pmw3610_Power_Up_Reset  = 0x3A,
+    pmw3610_Shutdown        = 0x3B,
+    pmw3610_SPI_Clk_On_Req  = 0x41,
+    pmw3610_SPI_Page1       = 0x7E,
+    pmw3610_SPI_Page0       = 0x7F,
+
+    // Registers in page 1.
+    pmw3610_Res_Step        = 0x05,
+} pmw3610_reg_t;
+
+enum {
+    pmw3610_MAXCPI = 0x0F, // = 15: 3200 CPI
+};
+
+//////////////////////////////////////////////////////////////////////////////
+// Top level API
+
+/// pmw3610_init initializes PMW3610DM-SUDU module.
+/// It will return true when succeeded, otherwise false.
+bool pmw3610_init(void);
+
+/// pmw3610_verify checks the sensor keeps the configuration, by reading
+/// Res_Step.  It returns false when the sensor seems to have been reset: by
+/// ESD or brown-out for example.
+bool pmw3610_verify(void);
+
+/// pmw3610_recover resets the sensor, and restores the configuration.  It
+/// returns false when the sensor doesn't respond.
+bool pmw3610_recover(void);
+
+/// pmw3610_motion_burst gets a motion data by Burst_Read command.
+/// It returns MOT flag: false when no motion has occurred.
+bool pmw3610_motion_burst(pmw3610_motion_t *d);
+
+/// pmw3610_cpi_get gets CPI value of the sensor, without SPI transaction.
+uint8_t pmw3610_cpi_get(void);
+
+/// pmw3610_cpi_set sets CPI value of the sensor.  Valid values are between 0
+/// and pmw3610_MAXCPI, and the actual CPI is (cpi + 1) * 200.
+void pmw3610_cpi_set(uint8_t cpi);
+
+/// pmw3610_quality_read reads SQUAL (surface quality) and Shutter (exposure)
+/// registers.
+void pmw3610_quality_read(uint8_t *squal, uint16_t *shutter);
+
+//////////////////////////////////////////////////////////////////////////////
+// Register operations
+
+/// pmw3610_reg_write writes a value to a register.  It enables SPI clock of
+/// the sensor while writing, which is required to write registers.
+void pmw3610_reg_write(uint8_t addr, uint8_t data);
+
+/// pmw3610_reg_read reads a value from a register.
+uint8_t pmw3610_reg_read(uint8_t addr);
@@ -40,7 +40,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 // it has been reported to work well in such cases.
 //#define SPLIT_WATCHDOG_ENABLE
 
-#define SPLIT_TRANSACTION_IDS_KB KEYBALL_GET_INFO, KEYBALL_GET_MOTION, KEYBALL_SET_CPI
+#define SPLIT_TRANSACTION_IDS_KB KEYBALL_GET_INFO, KEYBALL_GET_MOTION, KEYBALL_SET_CPI, KEYBALL_SET_SENSOR, KEYBALL_CAL_LIFT, KEYBALL_GET_STATS
+
+// Keyball keeps its configuration (keyball_store_t, 40 bytes) in the
+// keyboard level data block of EEPROM.  It has 3 slots for wear leveling.
+#define EECONFIG_KB_DATA_SIZE 128
 
 // RGB LED settings
 #define WS2812_DI_PIN       D3
@@ -61,6 +65,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #    endif
 #endif
 #ifdef RGB_MATRIX_ENABLE
+#    define RGB_MATRIX_LED_COUNT 48
 #    define RGB_MATRIX_SPLIT    { 24, 24 }
 #endif
 
@@ -35,6 +35,45 @@ matrix_row_t matrix_mask[MATRIX_ROWS] = {
 };
 // clang-format on
 
+//////////////////////////////////////////////////////////////////////////////
+
+#ifdef RGB_MATRIX_ENABLE
+// LED maps in order of LED chains, set by keyball_on_adjust_layout().
+led_config_t g_led_config;
+
+// clang-format off
+static const keyball_led_t led_map_ball[] PROGMEM = {
+    KEYBALL_LED_UNDER(  7, 54), KEYBALL_LED_UNDER( 25, 46), KEYBALL_LED_UNDER( 61, 40),
+    KEYBALL_LED_UNDER(112, 51), KEYBALL_LED_UNDER(112, 18), KEYBALL_LED_UNDER( 50, 10),
+    KEYBALL_LED_KEY(0, 0, 112, 10), KEYBALL_LED_KEY(1, 0, 112, 27), KEYBALL_LED_KEY(2, 0, 112, 43),
+    KEYBALL_LED_KEY(3, 0, 112, 59), KEYBALL_LED_KEY(0, 1,  91,  4), KEYBALL_LED_KEY(1, 1,  91, 20),
+    KEYBALL_LED_KEY(2, 1,  91, 37), KEYBALL_LED_KEY(0, 2,  71,  0), KEYBALL_LED_KEY(1, 2,  71, 16),
+    KEYBALL_LED_KEY(2, 2,  71, 33), KEYBALL_LED_KEY(0, 3,  50,  2), KEYBALL_LED_KEY(1, 3,  50, 19),
+    KEYBALL_LED_KEY(2, 3,  50, 35), KEYBALL_LED_KEY(0, 4,  30,  4), KEYBALL_LED_KEY(1, 4,  30, 21),
+    KEYBALL_LED_KEY(2, 4,  30, 37),
+};
+
+static const keyball_led_t led_map_noball[] PROGMEM = {
+    KEYBALL_LED_KEY(0, 4,  30,  4), KEYBALL_LED_KEY(1, 4,  30, 21), KEYBALL_LED_KEY(2, 4,  30, 37),
+    KEYBALL_LED_KEY(0, 3,  50,  2), KEYBALL_LED_KEY(1, 3,  50, 19), KEYBALL_LED_KEY(2, 3,  50, 35),
+    KEYBALL_LED_KEY(0, 2,  71,  0), KEYBALL_LED_KEY(1, 2,  71, 16), KEYBALL_LED_KEY(2, 2,  71, 33),
+    KEYBALL_LED_KEY(3, 2,  71, 49), KEYBALL_LED_KEY(0, 1,  91,  4), KEYBALL_LED_KEY(1, 1,  91, 20),
+    KEYBALL_LED_KEY(2, 1,  91, 37), KEYBALL_LED_KEY(3, 1,  91, 53), KEYBALL_LED_KEY(0, 0, 112, 10),
+    KEYBALL_LED_KEY(1, 0, 112, 27), KEYBALL_LED_KEY(2, 0, 112, 43), KEYBALL_LED_KEY(3, 0, 112, 59),
+    KEYBALL_LED_UNDER( 50, 10), KEYBALL_LED_UNDER(112, 18), KEYBALL_LED_UNDER(112, 51),
+    KEYBALL_LED_UNDER( 71, 41), KEYBALL_LED_UNDER( 33, 51), KEYBALL_LED_UNDER(  8, 54),
+};
+// clang-format on
+
+static void led_map_apply(bool is_left, bool have_ball) {
+    if (have_ball) {
+        keyball_led_map_apply(is_left, led_map_ball, sizeof(led_map_ball) / sizeof(led_map_ball[0]));
+    } else {
+        keyball_led_map_apply(is_left, led_map_noball, sizeof(led_map_noball) / sizeof(led_map_noball[0]));
+    }
+}
+#endif
+
 void keyball_on_adjust_layout(keyball_adjust_t v) {
 #ifdef RGBLIGHT_ENABLE
     // adjust RGBLIGHT's clipping and effect ranges
@@ -43,4 +82,10 @@ void keyball_on_adjust_layout(keyball_adjust_t v) {
     rgblight_set_clipping_range(is_keyboard_left() ? 0 : lednum_that, lednum_this);
     rgblight_set_effect_range(0, lednum_this + lednum_that);
 #endif
+#ifdef RGB_MATRIX_ENABLE
+    // select LED maps by PCBs of both sides.  The other side is assumed no
+    // ball until negotiated.
+    led_map_apply(is_keyboard_left(), keyball.this_have_ball);
+    led_map_apply(!is_keyboard_left(), keyball.that_have_ball);
+#endif
 }
@@ -36,3 +36,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define TAP_CODE_DELAY 5
 #define DYNAMIC_KEYMAP_LAYER_COUNT 7
 #define TAPPING_TERM 150
+
+// トラックボールを動かすとレイヤー6(クリックレイヤー)を有効にする。
+// Turn on layer 6 (the click layer) by moving the trackball.
+#define KEYBALL_CLICK_LAYER 6
+
+// スクロール除数1/32: 以前のしきい値50に近い。 Scroll divider 1/32, close to
+// the former threshold of 50 counts.
+#define KEYBALL_SCROLL_DIV_DEFAULT 6
@@ -33,7 +33,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #endif
 
 // PMW3360 performance counter. Require CONSOLE_ENABLE too.
-//#define DEBUG_PMW3360_SCAN_RATE
+//#define DEBUG_PMW33XX_SCAN_RATE
 
 // Disable mouse report rate throttling.
 //#define KEYBALL_REPORTMOUSE_INTERVAL 0
@@ -51,7 +51,7 @@ void oledkit_render_info_user(void) {
 #endif
 
 void keyboard_post_init_user(void) {
-#if defined(DEBUG_PMW3360_SCAN_RATE) && defined(CONSOLE_ENABLE)
+#if defined(DEBUG_PMW33XX_SCAN_RATE) && defined(CONSOLE_ENABLE)
     debug_enable = true;
 #endif
 }
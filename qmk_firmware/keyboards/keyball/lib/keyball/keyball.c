@@ -21,18 +21,85 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #endif
 
 #include "keyball.h"
-#include "drivers/pmw3360/pmw3360.h"
+#include "sensor.h"
+#ifdef KEYBALL_HID_ENABLE
+#    include "raw_hid.h"
+#endif
 
+#include <stddef.h>
 #include <string.h>
 
 const uint8_t CPI_DEFAULT    = KEYBALL_CPI_DEFAULT / 100;
-const uint8_t CPI_MAX        = pmw3360_MAXCPI + 1;
+const uint8_t CPI_MAX        = SENSOR_CPI_MAX;
 const uint8_t SCROLL_DIV_MAX = 7;
+const uint8_t KINETIC_MAX    = 6;
+const uint8_t REPORT_INT_MAX = 14; // msec, kept in 4 bits of keyball_config_t
 
 const uint16_t AML_TIMEOUT_MIN = 100;
 const uint16_t AML_TIMEOUT_MAX = 1000;
 const uint16_t AML_TIMEOUT_QU  = 50;   // Quantization Unit
 
+const uint8_t CLICK_THRESHOLD_MIN = 5;
+const uint8_t CLICK_THRESHOLD_MAX = 155;
+const uint8_t CLICK_THRESHOLD_QU  = 5; // Quantization Unit
+
+_Static_assert(sizeof(keyball_calib_t) == 8, "keyball_calib_t should be 8 bytes");
+_Static_assert(sizeof(keyball_config_t) == 4, "keyball_config_t should be 4 bytes");
+_Static_assert(sizeof(keyball_ball_t) == 4, "keyball_ball_t should be 4 bytes");
+_Static_assert(sizeof(keyball_store_t) == 40, "keyball_store_t should be 40 bytes");
+_Static_assert(sizeof(keyball_telemetry_t) == 30, "keyball_telemetry_t should fit in a raw HID packet");
+_Static_assert(EECONFIG_KB_DATA_SIZE >= sizeof(keyball_store_t) * 2, "EECONFIG_KB_DATA_SIZE should have 2 or more slots of keyball_store_t");
+
+#if KEYBALL_REPORTMOUSE_INTERVAL > 14
+#    error KEYBALL_REPORTMOUSE_INTERVAL should be 14 or less, to be kept in profiles.
+#endif
+
+#if defined(KEYBALL_CLICK_LAYER) && defined(POINTING_DEVICE_AUTO_MOUSE_ENABLE)
+#    error KEYBALL_CLICK_LAYER and POINTING_DEVICE_AUTO_MOUSE_ENABLE are exclusive. Please choose one.
+#endif
+
+#if defined(KEYBALL_CLICK_LAYER) && (KEYBALL_CLICK_LAYER_THRESHOLD < 5 || KEYBALL_CLICK_LAYER_THRESHOLD > 155 || KEYBALL_CLICK_LAYER_THRESHOLD % 5 != 0)
+#    error KEYBALL_CLICK_LAYER_THRESHOLD should be a multiple of 5 between 5 and 155, to be kept in profiles.
+#endif
+
+#if defined(KEYBALL_JITTER_FILTER_ENABLE) && (KEYBALL_JITTER_MIN_ALPHA < 1 || KEYBALL_JITTER_MIN_ALPHA > 16)
+#    error KEYBALL_JITTER_MIN_ALPHA should be between 1 and 16.
+#endif
+
+#if defined(KEYBALL_GESTURE_ENABLE) && KEYBALL_GESTURE_DIRECTIONS != 4 && KEYBALL_GESTURE_DIRECTIONS != 8
+#    error Invalid value for KEYBALL_GESTURE_DIRECTIONS. Please choose 4 or 8.
+#endif
+
+#if KEYBALL_SENSOR_MERGE != 0 && KEYBALL_SENSOR_MERGE != 1
+#    error Invalid value for KEYBALL_SENSOR_MERGE. Please choose 0 or 1.
+#endif
+
+#if KEYBALL_REST_PROFILE != 0 && !SENSOR_HAS_REST
+#    error KEYBALL_REST_PROFILE is not supported by KEYBALL_SENSOR. Please choose 0.
+#endif
+
+#if KEYBALL_REST_PROFILE == 1
+static const sensor_rest_t REST_PROFILE = {
+    .run_downshift   = 0x32,   // 500ms
+    .rest1_rate      = 0x0000, // 1ms
+    .rest1_downshift = 0x1f,   // 320 * 31 frames: 10s
+    .rest2_rate      = 0x0063, // 100ms
+    .rest2_downshift = 0xbc,   // 32 * 188 frames: 10min
+    .rest3_rate      = 0x01f3, // 500ms
+};
+#elif KEYBALL_REST_PROFILE == 2
+static const sensor_rest_t REST_PROFILE = {
+    .run_downshift   = 0x0a,   // 100ms
+    .rest1_rate      = 0x0001, // 2ms
+    .rest1_downshift = 0x05,   // 320 * 5 frames: 3s
+    .rest2_rate      = 0x0031, // 50ms
+    .rest2_downshift = 0x13,   // 32 * 19 frames: 30s
+    .rest3_rate      = 0x00c7, // 200ms
+};
+#elif KEYBALL_REST_PROFILE != 0
+#    error Invalid value for KEYBALL_REST_PROFILE. Please choose 0, 1 or 2.
+#endif
+
 static const char BL = '\xB0'; // Blank indicator character
 static const char LFSTR_ON[] PROGMEM = "\xB2\xB3";
 static const char LFSTR_OFF[] PROGMEM = "\xB4\xB5";
@@ -48,17 +115,164 @@ keyball_t keyball = {
     .cpi_value   = 0,
     .cpi_changed = false,
 
+    .report_interval = KEYBALL_REPORTMOUSE_INTERVAL,
+    .profile         = 0,
+
+#ifdef KEYBALL_CLICK_LAYER
+    .click_enable    = true,
+    .click_threshold = KEYBALL_CLICK_LAYER_THRESHOLD,
+#endif
+
     .scroll_mode = false,
     .scroll_div  = 0,
 
+#ifdef KEYBALL_KINETIC_SCROLL_ENABLE
+    .kinetic_level = KEYBALL_KINETIC_SCROLL_DEFAULT,
+#endif
+
     .pressing_keys = { BL, BL, BL, BL, BL, BL, 0 },
 };
 
+#ifdef KEYBALL_TELEMETRY_ENABLE
+// telemetry collects statistics for the next packet.  The secondary counts
+// polls without reset and keeps stats for KEYBALL_GET_STATS, and the primary
+// makes them per packet with the count fetched last.
+static struct {
+    keyball_telemetry_t pkt;
+    keyball_stats_t     stats;      // the secondary: sampled for the primary
+    bool                sample;     // the secondary: stats should be sampled
+    uint16_t            that_polls; // the primary: count fetched last
+    bool                that_valid; // the primary: that_polls is fetched
+    uint16_t            interval;   // msec, 0: stopped
+    uint32_t            requested;  // time when the host requested last
+    uint32_t            sent;
+} telemetry;
+
+// telemetry_count_poll counts a poll of sensors.  It is atomic because the
+// secondary reads the count in interrupt of the split link.
+static inline void telemetry_count_poll(void) {
+    ATOMIC_BLOCK_FORCEON {
+        telemetry.pkt.polls++;
+    }
+}
+#endif
+
+#ifdef KEYBALL_CLICK_LAYER
+// click is states of the click layer on the primary.
+static struct {
+    bool     on;     // KEYBALL_CLICK_LAYER is turned on by this
+    uint16_t motion; // motion towards the threshold while off
+    uint32_t moved;  // time of the last motion, or click while on
+    uint8_t  held;   // mouse keys being held
+    uint8_t  lock;   // motion left to unlock the pointer after clicking
+} click;
+#endif
+
+#ifdef KEYBALL_GESTURE_ENABLE
+// gesture is states of gesture mode on the primary.
+static struct {
+    bool     mode;  // gesture mode is on
+    bool     fired; // a gesture was input, wait for the trackball to stop
+    int16_t  x;     // motion of the current gesture
+    int16_t  y;
+    uint32_t moved; // time of the last motion
+} gesture;
+
+static const uint16_t PROGMEM GESTURE_KEYCODES[KEYBALL_GESTURE_COUNT] = KEYBALL_GESTURE_KEYCODES;
+#endif
+
+#ifdef KEYBALL_KEY_MODE_ENABLE
+// keys is states of key mode on the primary, indexed by 0 for the left
+// trackball and 1 for the right.
+static struct {
+    uint8_t mode[2];  // keyball_keys_t set by keyball_set_key_mode()
+    uint8_t layer[2]; // keyball_keys_t selected by KEYBALL_KEY_MODE_LAYERS
+    int16_t x[2];     // pointer motion less than a tap
+    int16_t y[2];
+} keys;
+
+static const uint8_t PROGMEM KEY_MODE_KEYCODES[KEYBALL_KEYS_COUNT - 1][4] = KEYBALL_KEY_MODE_KEYCODES;
+#endif
+
+#ifdef KEYBALL_DUAL_GESTURE_ENABLE
+// dual_axis_t is an axis of relative motion of two trackballs.
+typedef enum {
+    DUAL_NONE = 0,
+    DUAL_ZOOM,   // x: apart or together
+    DUAL_ROTATE, // y: one up and the other down
+} dual_axis_t;
+
+// dual is states of dual gestures on the primary.
+static struct {
+    uint8_t  axis;    // dual_axis_t of the current gesture
+    int16_t  lx;      // pointer motion of the left trackball in the window
+    int16_t  ly;
+    int16_t  rx;      // pointer motion of the right trackball in the window
+    int16_t  ry;
+    int16_t  rest;    // relative motion less than a step
+    uint32_t started; // time when the window started
+    uint32_t moved;   // time of the last motion
+    uint8_t  mods;    // mods registered by the default hook while zooming
+} dual;
+
+static const uint16_t PROGMEM DUAL_ROTATE_KEYCODES[2] = KEYBALL_DUAL_GESTURE_ROTATE_KEYCODES;
+#endif
+
 //////////////////////////////////////////////////////////////////////////////
 // Hook points
 
 __attribute__((weak)) void keyball_on_adjust_layout(keyball_adjust_t v) {}
 
+__attribute__((weak)) bool keyball_on_task_rgb(void) {
+    return false;
+}
+
+__attribute__((weak)) bool keyball_on_raw_hid_receive(uint8_t *data, uint8_t length) {
+    return false;
+}
+
+__attribute__((weak)) void keyball_on_gesture(keyball_gesture_t g) {
+#ifdef KEYBALL_GESTURE_ENABLE
+    uint16_t kc = pgm_read_word(&GESTURE_KEYCODES[g]);
+    if (kc != KC_NO) {
+        tap_code16(kc);
+    }
+#endif
+}
+
+__attribute__((weak)) void keyball_on_dual_gesture(keyball_dual_gesture_t g, report_mouse_t *r) {
+#ifdef KEYBALL_DUAL_GESTURE_ENABLE
+    switch (g) {
+        case KEYBALL_DUAL_GESTURE_ZOOM_START:
+            // hold only mods which are not held yet, to leave mods of the
+            // user as they were at the end.
+            dual.mods = KEYBALL_DUAL_GESTURE_ZOOM_MODS & ~get_mods();
+            register_mods(dual.mods);
+            break;
+        case KEYBALL_DUAL_GESTURE_ZOOM_END:
+            unregister_mods(dual.mods);
+            dual.mods = 0;
+            break;
+        case KEYBALL_DUAL_GESTURE_ZOOM_IN:
+            r->v++;
+            break;
+        case KEYBALL_DUAL_GESTURE_ZOOM_OUT:
+            r->v--;
+            break;
+        case KEYBALL_DUAL_GESTURE_ROTATE_CW:
+        case KEYBALL_DUAL_GESTURE_ROTATE_CCW: {
+            uint16_t kc = pgm_read_word(&DUAL_ROTATE_KEYCODES[g - KEYBALL_DUAL_GESTURE_ROTATE_CW]);
+            if (kc != KC_NO) {
+                tap_code16(kc);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+#endif
+}
+
 //////////////////////////////////////////////////////////////////////////////
 // Static utilities
 
@@ -86,6 +300,42 @@ static inline int8_t clip2int8(int16_t v) {
     return (v) < -127 ? -127 : (v) > 127 ? 127 : (int8_t)v;
 }
 
+// clip2uint8 clips an integer fit into uint8_t.
+static inline uint8_t clip2uint8(int16_t v) {
+    return (v) < 0 ? 0 : (v) > 255 ? 255 : (uint8_t)v;
+}
+
+// ball_cpi returns CPI of the trackball at the side, as keyball_get_cpi().
+static uint8_t ball_cpi(bool is_left) {
+    uint8_t cpi = keyball.ball[is_left ? 0 : 1].cpi;
+    return cpi != 0 ? cpi : keyball_get_cpi();
+}
+
+// ball_scroll_div returns scroll divider of the trackball at the side.
+static uint8_t ball_scroll_div(bool is_left) {
+    uint8_t div = keyball.ball[is_left ? 0 : 1].sdiv;
+    return div != 0 ? div : keyball_get_scroll_div();
+}
+
+// ball_scroll returns true when the trackball at the side scrolls in
+// scroll_mode.
+static bool ball_scroll(bool is_left, bool scroll_mode) {
+    bool scroll;
+    switch (keyball.ball[is_left ? 0 : 1].mode) {
+        case KEYBALL_BALL_POINTER:
+            scroll = false;
+            break;
+        case KEYBALL_BALL_SCROLL:
+            scroll = true;
+            break;
+        default:
+            // the trackball of the secondary scrolls when the primary has one.
+            scroll = is_left != is_keyboard_left() && keyball.this_have_ball;
+            break;
+    }
+    return scroll != scroll_mode;
+}
+
 #ifdef OLED_ENABLE
 static const char *format_4d(int8_t d) {
     static char buf[5] = {0}; // max width (4) + NUL (1)
@@ -120,6 +370,11 @@ static char to_1x(uint8_t x) {
 }
 #endif
 
+#define EEPROM_CONFIG 0x01
+#define EEPROM_CALIB 0x02
+
+static void save_eeprom(uint8_t parts);
+
 static void add_cpi(int8_t delta) {
     int16_t v = keyball_get_cpi() + delta;
     keyball_set_cpi(v < 1 ? 1 : v);
@@ -130,31 +385,33 @@ static void add_scroll_div(int8_t delta) {
     keyball_set_scroll_div(v < 1 ? 1 : v);
 }
 
+#ifdef KEYBALL_KINETIC_SCROLL_ENABLE
+static void add_kinetic_scroll(int8_t delta) {
+    int8_t v = keyball_get_kinetic_scroll() + delta;
+    keyball_set_kinetic_scroll(v < 0 ? 0 : v);
+}
+#endif
+
 //////////////////////////////////////////////////////////////////////////////
 // Pointing device driver
 
 #if KEYBALL_MODEL == 46
 void keyboard_pre_init_kb(void) {
-    keyball.this_have_ball = pmw3360_init();
+    keyball.this_have_ball = sensor_init();
     keyboard_pre_init_user();
 }
 #endif
 
 void pointing_device_driver_init(void) {
 #if KEYBALL_MODEL != 46
-    keyball.this_have_ball = pmw3360_init();
+    keyball.this_have_ball = sensor_init();
 #endif
     if (keyball.this_have_ball) {
-#if defined(KEYBALL_PMW3360_UPLOAD_SROM_ID)
-#    if KEYBALL_PMW3360_UPLOAD_SROM_ID == 0x04
-        pmw3360_srom_upload(pmw3360_srom_0x04);
-#    elif KEYBALL_PMW3360_UPLOAD_SROM_ID == 0x81
-        pmw3360_srom_upload(pmw3360_srom_0x81);
-#    else
-#        error Invalid value for KEYBALL_PMW3360_UPLOAD_SROM_ID. Please choose 0x04 or 0x81 or disable it.
-#    endif
+        sensor_srom_upload();
+        sensor_cpi_set(CPI_DEFAULT - 1);
+#if KEYBALL_REST_PROFILE != 0
+        sensor_rest_set(&REST_PROFILE);
 #endif
-        pmw3360_cpi_set(CPI_DEFAULT - 1);
     }
 }
 
@@ -185,9 +442,88 @@ __attribute__((weak)) void keyball_on_apply_motion_to_mouse_move(keyball_motion_
     m->y = 0;
 }
 
+#if KEYBALL_SCROLLSNAP_ENABLE == 2
+// scrollsnap_auto determines the direction of scroll from motion m of a
+// trackball with states s, and locks scroll to the direction by removing
+// motion across it from m.  It returns false while the direction is not
+// determined yet, and m should be kept to accumulate the motion.
+static bool scrollsnap_auto(keyball_scrollsnap_auto_t *s, keyball_motion_t *m) {
+#    if KEYBALL_MODEL == 46
+    int16_t *mv = &m->y;
+    int16_t *mh = &m->x;
+    int16_t  rv = s->rest.y;
+    int16_t  rh = s->rest.x;
+#    else
+    int16_t *mv = &m->x;
+    int16_t *mh = &m->y;
+    int16_t  rv = s->rest.x;
+    int16_t  rh = s->rest.y;
+#    endif
+    uint32_t now = timer_read32();
+    if (TIMER_DIFF_32(now, s->last) >= KEYBALL_SCROLLSNAP_AUTO_IDLE) {
+        // the last gesture has finished.
+        s->dir     = KEYBALL_SCROLLSNAP_MODE_FREE;
+        s->tension = 0;
+        s->rest    = (keyball_motion_t){0};
+        rv = rh = 0;
+    }
+    // new motion since last report.
+    int16_t nv = *mv - rv;
+    int16_t nh = *mh - rh;
+    if (nv != 0 || nh != 0) {
+        s->last = now;
+    }
+
+    switch (s->dir) {
+        case KEYBALL_SCROLLSNAP_MODE_VERTICAL:
+            s->tension += abs(nh) - abs(nv);
+            break;
+        case KEYBALL_SCROLLSNAP_MODE_HORIZONTAL:
+            s->tension += abs(nv) - abs(nh);
+            break;
+        default:
+            // determine the direction by the dominant axis of accumulated
+            // motion.
+            if (abs(*mv) + abs(*mh) < KEYBALL_SCROLLSNAP_AUTO_LOCK_THRESHOLD) {
+                s->rest = *m;
+                return false;
+            }
+            s->dir = abs(*mv) >= abs(*mh) ? KEYBALL_SCROLLSNAP_MODE_VERTICAL : KEYBALL_SCROLLSNAP_MODE_HORIZONTAL;
+            break;
+    }
+    if (s->tension < 0) {
+        s->tension = 0;
+    } else if (s->tension >= KEYBALL_SCROLLSNAP_AUTO_UNLOCK_TENSION) {
+        // direction has been changed: determine it again.
+        s->dir     = KEYBALL_SCROLLSNAP_MODE_FREE;
+        s->tension = 0;
+        s->rest    = *m;
+        return false;
+    }
+
+    // drop motion across the direction.
+    if (s->dir == KEYBALL_SCROLLSNAP_MODE_VERTICAL) {
+        *mh = 0;
+    } else {
+        *mv = 0;
+    }
+    return true;
+}
+#endif
+
 __attribute__((weak)) void keyball_on_apply_motion_to_mouse_scroll(keyball_motion_t *m, report_mouse_t *r, bool is_left) {
+#if KEYBALL_SCROLLSNAP_ENABLE == 2
+    // each trackball has its own states, and a ball without motion keeps them.
+    keyball_scrollsnap_auto_t *snap      = &keyball.scrollsnap_auto[is_left ? 0 : 1];
+    bool                       snap_auto = keyball_get_scrollsnap_mode() == KEYBALL_SCROLLSNAP_MODE_AUTO && (m->x != 0 || m->y != 0);
+    if (snap_auto && !scrollsnap_auto(snap, m)) {
+        // keep motion until the direction is determined.
+        return;
+    }
+#endif
+
     // consume motion of trackball.
-    int16_t div = 1 << (keyball_get_scroll_div() - 1);
+    int16_t div = 1 << (ball_scroll_div(is_left) - 1);
     int16_t x = divmod16(&m->x, div);
     int16_t y = divmod16(&m->y, div);
 
@@ -232,154 +568,1461 @@ __attribute__((weak)) void keyball_on_apply_motion_to_mouse_scroll(keyball_motio
             // pass by without doing anything
             break;
     }
+    if (snap_auto) {
+        // remember motion left by scroll divider to detect new motion.
+        snap->rest = *m;
+    }
 #endif
 }
 
-static void motion_to_mouse(keyball_motion_t *m, report_mouse_t *r, bool is_left, bool as_scroll) {
+#ifdef KEYBALL_JITTER_FILTER_ENABLE
+// jitter_filter smooths motion m in place for pointer movement.
+//
+// It is an integer variant of 1-euro filter: the weight of a new sample
+// (alpha) grows with the speed, so slow motion is smoothed strongly and fast
+// motion passes through as is.  Motion slower than the deadband is held and
+// not reported, then QMK sends no report for it at all.  The held motion is
+// reported when it adds up beyond the deadband, or added to the next motion
+// out of it, or dropped after KEYBALL_JITTER_DEADBAND_TIMEOUT.
+static void jitter_filter(keyball_motion_t *m, keyball_jitter_t *f, bool as_scroll) {
+    int16_t x = m->x;
+    int16_t y = m->y;
     if (as_scroll) {
-        keyball_on_apply_motion_to_mouse_scroll(m, r, is_left);
+        memset(f, 0, sizeof(*f));
+        return;
+    }
+
+    // update speed: follow acceleration immediately, deceleration slowly.
+    uint16_t s = abs(x) + abs(y);
+    if (s >= f->speed) {
+        f->speed = s > 255 ? 255 : s;
     } else {
-        keyball_on_apply_motion_to_mouse_move(m, r, is_left);
+        f->speed -= (f->speed - s + 3) / 4;
     }
-}
 
-static inline bool should_report(void) {
-    uint32_t now = timer_read32();
-#if defined(KEYBALL_REPORTMOUSE_INTERVAL) && KEYBALL_REPORTMOUSE_INTERVAL > 0
-    // throttling mouse report rate.
-    static uint32_t last = 0;
-    if (TIMER_DIFF_32(now, last) < KEYBALL_REPORTMOUSE_INTERVAL) {
-        return false;
+    int16_t alpha = KEYBALL_JITTER_MIN_ALPHA + (16 - KEYBALL_JITTER_MIN_ALPHA) * f->speed / KEYBALL_JITTER_CUTOFF_SPEED;
+    if (f->speed <= KEYBALL_JITTER_DEADBAND) {
+        uint32_t now = timer_read32();
+        if ((f->dx == 0 && f->dy == 0) || TIMER_DIFF_32(now, f->held) >= KEYBALL_JITTER_DEADBAND_TIMEOUT) {
+            f->dx   = 0;
+            f->dy   = 0;
+            f->held = now;
+        }
+        f->dx = add16(f->dx, x);
+        f->dy = add16(f->dy, y);
+        // report the rest of smoothed motion at once, which is the decay of
+        // the smoothed velocity, not to lose it.
+        m->x  = (f->rx + (int32_t)f->vx * (16 - alpha) / alpha) / 16;
+        m->y  = (f->ry + (int32_t)f->vy * (16 - alpha) / alpha) / 16;
+        f->vx = 0;
+        f->vy = 0;
+        f->rx = 0;
+        f->ry = 0;
+        // release held motion which adds up beyond the deadband: slow motion
+        // does, while jitter cancels out.
+        if (abs(f->dx) + abs(f->dy) > KEYBALL_JITTER_DEADBAND) {
+            m->x  = add16(m->x, f->dx);
+            m->y  = add16(m->y, f->dy);
+            f->dx = 0;
+            f->dy = 0;
+        }
+        return;
     }
-    last = now;
-#endif
-#if defined(KEYBALL_SCROLLBALL_INHIVITOR) && KEYBALL_SCROLLBALL_INHIVITOR > 0
-    if (TIMER_DIFF_32(now, keyball.scroll_mode_changed) < KEYBALL_SCROLLBALL_INHIVITOR) {
-        keyball.this_motion.x = 0;
-        keyball.this_motion.y = 0;
-        keyball.that_motion.x = 0;
-        keyball.that_motion.y = 0;
+    x     = add16(x, f->dx);
+    y     = add16(y, f->dy);
+    f->dx = 0;
+    f->dy = 0;
+
+    if (f->speed >= KEYBALL_JITTER_CUTOFF_SPEED) {
+        // transparent: pass through and forget all filter states.
+        memset(f, 0, sizeof(*f));
+        f->speed = KEYBALL_JITTER_CUTOFF_SPEED;
+        m->x     = x;
+        m->y     = y;
+        return;
     }
+
+    f->vx += (int32_t)(x * 16 - f->vx) * alpha / 16;
+    f->vy += (int32_t)(y * 16 - f->vy) * alpha / 16;
+
+    // report integer part, and carry fraction part over to next report.
+    int16_t ax = f->rx + f->vx;
+    int16_t ay = f->ry + f->vy;
+    m->x       = ax / 16;
+    m->y       = ay / 16;
+    f->rx      = ax - m->x * 16;
+    f->ry      = ay - m->y * 16;
+}
 #endif
-    return true;
+
+#ifdef KEYBALL_KINETIC_SCROLL_ENABLE
+static void kinetic_scroll_cancel(void) {
+    memset(&keyball.this_kinetic, 0, sizeof(keyball.this_kinetic));
+    memset(&keyball.that_kinetic, 0, sizeof(keyball.that_kinetic));
 }
 
-report_mouse_t pointing_device_driver_get_report(report_mouse_t rep) {
-    // fetch from optical sensor.
-    if (keyball.this_have_ball) {
-        pmw3360_motion_t d = {0};
-        if (pmw3360_motion_burst(&d)) {
-            ATOMIC_BLOCK_FORCEON {
-                keyball.this_motion.x = add16(keyball.this_motion.x, d.x);
-                keyball.this_motion.y = add16(keyball.this_motion.y, d.y);
-            }
+// kinetic_scroll tracks velocity of motion m in scroll mode, and adds decaying
+// motion to m after the ball is released at speed.  The added motion is
+// consumed by keyball_on_apply_motion_to_mouse_scroll() as same as real one,
+// so scroll divider and scroll snap are applied to it too.
+static void kinetic_scroll(keyball_motion_t *m, keyball_kinetic_t *k, bool as_scroll) {
+    if (!as_scroll || keyball.kinetic_level == 0) {
+        memset(k, 0, sizeof(*k));
+        return;
+    }
+
+    // new motion since last report: track velocity, and cancel glide.
+    int16_t ix = m->x - k->lx;
+    int16_t iy = m->y - k->ly;
+    if (ix != 0 || iy != 0) {
+        k->gliding = false;
+        k->vx += ((int32_t)clip2int8(ix) * 256 - k->vx) / 2;
+        k->vy += ((int32_t)clip2int8(iy) * 256 - k->vy) / 2;
+        return;
+    }
+
+    // ball released: start glide only when it was fast enough.
+    if (!k->gliding) {
+        if ((uint16_t)abs(k->vx) + (uint16_t)abs(k->vy) < KEYBALL_KINETIC_SCROLL_THRESHOLD * 256) {
+            memset(k, 0, sizeof(*k));
+            return;
         }
+        k->gliding = true;
     }
-    // report mouse event, if keyboard is primary.
-    if (is_keyboard_master() && should_report()) {
-        // modify mouse report by PMW3360 motion.
-        motion_to_mouse(&keyball.this_motion, &rep, is_keyboard_left(), keyball.scroll_mode);
-        motion_to_mouse(&keyball.that_motion, &rep, !is_keyboard_left(), keyball.scroll_mode ^ keyball.this_have_ball);
-        // store mouse report for OLED.
-        keyball.last_mouse = rep;
+
+    // decay velocity: v *= 1 - 1 / 2^(level+1)
+    uint8_t shift = keyball.kinetic_level + 1;
+    k->vx -= k->vx >> shift;
+    k->vy -= k->vy >> shift;
+    if (abs(k->vx) < 256 && abs(k->vy) < 256) {
+        memset(k, 0, sizeof(*k));
+        return;
     }
-    return rep;
+
+    // emit integer part of velocity as motion, and keep the fraction.
+    k->fx += k->vx;
+    k->fy += k->vy;
+    int16_t dx = k->fx / 256;
+    int16_t dy = k->fy / 256;
+    k->fx -= dx * 256;
+    k->fy -= dy * 256;
+    m->x = add16(m->x, dx);
+    m->y = add16(m->y, dy);
 }
+#endif
 
 //////////////////////////////////////////////////////////////////////////////
-// Split RPC
+// Sensor calibration
 
-#ifdef SPLIT_KEYBOARD
+#define LIFT_CAL_THIS 0x01
+#define LIFT_CAL_THAT 0x02
 
-static void rpc_get_info_handler(uint8_t in_buflen, const void *in_data, uint8_t out_buflen, void *out_data) {
-    keyball_info_t info = {
-        .ballcnt = keyball.this_have_ball ? 1 : 0,
-    };
-    *(keyball_info_t *)out_data = info;
-    keyball_on_adjust_layout(KEYBALL_ADJUST_SECONDARY);
+// result of lift cutoff calibration of that sensor which failed to start.
+#define LIFT_CAL_FAILED -2
+
+// clang-format off
+// tan((n + 0.5) degrees) * 1024 for n = 0 ~ 29, to round skew to degrees.
+static const uint16_t PROGMEM tan_half_deg[] = {
+      9,  27,  45,  63,  81,  99, 117, 135, 153, 171,
+    190, 208, 227, 246, 265, 284, 303, 323, 343, 363,
+    383, 403, 424, 445, 467, 488, 511, 533, 556, 579,
+};
+// clang-format on
+
+static inline bool calibrating(void) {
+    return keyball.angle_cal || keyball.lift_cal != 0;
 }
 
-static void rpc_get_info_invoke(void) {
-    static bool     negotiated = false;
-    static uint32_t last_sync  = 0;
-    static int      round      = 0;
-    uint32_t        now        = timer_read32();
-    if (negotiated || TIMER_DIFF_32(now, last_sync) < KEYBALL_TX_GETINFO_INTERVAL) {
-        return;
-    }
-    last_sync = now;
-    round++;
-    keyball_info_t recv = {0};
-    if (!transaction_rpc_exec(KEYBALL_GET_INFO, 0, NULL, sizeof(recv), &recv)) {
-        if (round < KEYBALL_TX_GETINFO_MAXTRY) {
-            dprintf("keyball:rpc_get_info_invoke: missed #%d\n", round);
-            return;
-        }
+// current_sensor returns settings for the sensor at the side.  All
+// corrections are disabled while calibrating, to measure raw motion.
+static keyball_sensor_t current_sensor(bool is_left) {
+    if (calibrating()) {
+        return (keyball_sensor_t){0};
     }
-    negotiated             = true;
-    keyball.that_enable    = true;
-    keyball.that_have_ball = recv.ballcnt > 0;
-    dprintf("keyball:rpc_get_info_invoke: negotiated #%d %d\n", round, keyball.that_have_ball);
+    return (keyball_sensor_t){
+        .angle = keyball_get_angle(is_left),
+        .snap  = keyball_get_angle_snap(),
+        .lift  = keyball_get_lift_cutoff(is_left),
+    };
+}
 
-    // split keyboard negotiation completed.
+static void write_sensor(keyball_sensor_t s) {
+    sensor_angle_tune_set(s.angle);
+    sensor_angle_snap_set(s.snap);
+    sensor_lift_cutoff_set(s.lift);
+}
 
-#    ifdef VIA_ENABLE
-    // adjust VIA layout options according to current combination.
-    uint8_t  layouts = (keyball.this_have_ball ? (is_keyboard_left() ? 0x02 : 0x01) : 0x00) | (keyball.that_have_ball ? (is_keyboard_left() ? 0x01 : 0x02) : 0x00);
-    uint32_t curr    = via_get_layout_options();
-    uint32_t next    = (curr & ~0x3) | layouts;
-    if (next != curr) {
-        via_set_layout_options(next);
+// apply_sensor writes settings to this sensor, and requests to sync them to
+// that sensor.
+static void apply_sensor(void) {
+    if (keyball.this_have_ball) {
+        write_sensor(current_sensor(is_keyboard_left()));
     }
-#    endif
+    keyball.sensor_changed = true;
+}
 
-    keyball_on_adjust_layout(KEYBALL_ADJUST_PRIMARY);
+static void calibration_finish(void) {
+    keyball.angle_cal   = false;
+    keyball.lift_cal    = 0;
+    keyball.this_motion = (keyball_motion_t){0};
+    keyball.that_motion = (keyball_motion_t){0};
+    apply_sensor();
 }
 
-static void rpc_get_motion_handler(uint8_t in_buflen, const void *in_data, uint8_t out_buflen, void *out_data) {
-    *(keyball_motion_t *)out_data = keyball.this_motion;
-    // clear motion
-    keyball.this_motion.x = 0;
-    keyball.this_motion.y = 0;
+// skew_angle calculates the angle of motion m from "up" direction of the
+// trackball at the side, in degrees counterclockwise in sensor coordinates.
+// Angle_Tune rotates clockwise for positive values, so the result cancels the
+// skew as is.  It returns false when m was not rolled up.
+static bool skew_angle(const keyball_motion_t *m, bool is_left, int8_t *angle) {
+    // motion along and across "up" direction, see also
+    // keyball_on_apply_motion_to_mouse_move().
+#if KEYBALL_MODEL == 46
+    int16_t along  = m->y;
+    int16_t across = -m->x;
+#else
+    int16_t along  = is_left ? m->x : -m->x;
+    int16_t across = is_left ? m->y : -m->y;
+#endif
+    if (along <= 0) {
+        return false;
+    }
+    uint32_t t = (uint32_t)abs(across) * 1024 / along;
+    if (t > 1024) {
+        // more than 45 degrees: rolled to wrong direction.
+        return false;
+    }
+    uint8_t deg = 0;
+    while (deg < SENSOR_MAXANGLE && t >= pgm_read_word(tan_half_deg + deg)) {
+        deg++;
+    }
+    *angle = across < 0 ? -deg : deg;
+    return true;
 }
 
-static void rpc_get_motion_invoke(void) {
-    static uint32_t last_sync = 0;
-    uint32_t        now       = timer_read32();
-    if (TIMER_DIFF_32(now, last_sync) < KEYBALL_TX_GETMOTION_INTERVAL) {
-        return;
+// angle_calibrate accumulates motion of trackballs without reporting it, and
+// finishes angle calibration with the first trackball rolled enough.
+static void angle_calibrate(void) {
+    keyball_motion_t *m       = &keyball.this_motion;
+    bool              is_left = is_keyboard_left();
+    if (abs(m->x) + abs(m->y) < KEYBALL_ANGLE_CAL_DISTANCE) {
+        m       = &keyball.that_motion;
+        is_left = !is_left;
+        if (abs(m->x) + abs(m->y) < KEYBALL_ANGLE_CAL_DISTANCE) {
+            if (TIMER_DIFF_32(timer_read32(), keyball.cal_started) >= KEYBALL_ANGLE_CAL_TIMEOUT) {
+                dprintf("keyball:angle_calibrate: timeout\n");
+                calibration_finish();
+            }
+            return;
+        }
     }
-    keyball_motion_t recv = {0};
-    if (transaction_rpc_exec(KEYBALL_GET_MOTION, 0, NULL, sizeof(recv), &recv)) {
-        keyball.that_motion.x = add16(keyball.that_motion.x, recv.x);
-        keyball.that_motion.y = add16(keyball.that_motion.y, recv.y);
+    int8_t angle;
+    if (skew_angle(m, is_left, &angle)) {
+        dprintf("keyball:angle_calibrate: %s %d\n", is_left ? "left" : "right", angle);
+        keyball.calib.angle[is_left ? 0 : 1] = angle;
+        save_eeprom(EEPROM_CALIB);
     }
-    last_sync = now;
-    return;
+    calibration_finish();
 }
 
-static void rpc_set_cpi_handler(uint8_t in_buflen, const void *in_data, uint8_t out_buflen, void *out_data) {
-    keyball_set_cpi(*(keyball_cpi_t *)in_data);
+#ifdef SPLIT_KEYBOARD
+// lift_cal_remote starts (start = true) or polls lift cutoff calibration of
+// that sensor.  It returns as same as sensor_lift_cal_poll(), LIFT_CAL_FAILED
+// when it can't be started, and 0 for failure of communication on start.
+static int16_t lift_cal_remote(bool start) {
+    uint8_t req = start;
+    int16_t res = 0;
+    if (!transaction_rpc_exec(KEYBALL_CAL_LIFT, sizeof(req), &req, sizeof(res), &res)) {
+        // keep calibrating while polling.
+        return start ? 0 : -1;
+    }
+    return res;
 }
+#endif
 
-static void rpc_set_cpi_invoke(void) {
-    if (!keyball.cpi_changed) {
-        return;
+// lift_calibrate waits for sensors to finish lift cutoff calibration, and
+// discards motion of trackballs meanwhile.
+static void lift_calibrate(void) {
+    keyball.this_motion = (keyball_motion_t){0};
+    keyball.that_motion = (keyball_motion_t){0};
+    if (keyball.lift_cal & LIFT_CAL_THIS) {
+        int16_t r = sensor_lift_cal_poll();
+        if (r >= 0) {
+            dprintf("keyball:lift_calibrate: this %d\n", r);
+            keyball.calib.lift[is_keyboard_left() ? 0 : 1] = r;
+            keyball.lift_cal &= ~LIFT_CAL_THIS;
+        }
     }
-    keyball_cpi_t req = keyball.cpi_value;
-    if (!transaction_rpc_send(KEYBALL_SET_CPI, sizeof(req), &req)) {
+#ifdef SPLIT_KEYBOARD
+    if (keyball.lift_cal & LIFT_CAL_THAT) {
+        int16_t r = lift_cal_remote(false);
+        if (r == LIFT_CAL_FAILED) {
+            keyball.lift_cal &= ~LIFT_CAL_THAT;
+        } else if (r >= 0) {
+            dprintf("keyball:lift_calibrate: that %d\n", r);
+            keyball.calib.lift[is_keyboard_left() ? 1 : 0] = r;
+            keyball.lift_cal &= ~LIFT_CAL_THAT;
+        }
+    }
+#endif
+    if (keyball.lift_cal == 0) {
+        save_eeprom(EEPROM_CALIB);
+    } else if (TIMER_DIFF_32(timer_read32(), keyball.cal_started) < KEYBALL_LIFT_CAL_TIMEOUT) {
         return;
+    } else {
+        dprintf("keyball:lift_calibrate: timeout\n");
     }
-    keyball.cpi_changed = false;
+    calibration_finish();
 }
 
+#ifdef KEYBALL_RGB_MOTION_ENABLE
+// motion_peak_update records peak speed of trackballs for RGB lighting.
+static void motion_peak_update(void) {
+    uint16_t s = abs(keyball.this_motion.x) + abs(keyball.this_motion.y) + abs(keyball.that_motion.x) + abs(keyball.that_motion.y);
+    if (s > keyball.motion_peak) {
+        keyball.motion_peak = MIN(s, 0xff);
+    }
+}
 #endif
 
-//////////////////////////////////////////////////////////////////////////////
-// OLED utility
+#ifdef KEYBALL_CLICK_LAYER
+static void click_layer_off(void) {
+    if (click.on) {
+        layer_off(KEYBALL_CLICK_LAYER);
+    }
+    click.on     = false;
+    click.motion = 0;
+    click.lock   = 0;
+}
 
-#ifdef OLED_ENABLE
-// clang-format off
+// click_layer_motion turns the click layer on and off by pointer motion of a
+// mouse report, and drops motion locked by clicking.  It takes constant time
+// per report.
+static void click_layer_motion(report_mouse_t *r) {
+    if (!keyball.click_enable) {
+        return;
+    }
+    uint32_t now = timer_read32();
+    uint16_t d   = abs(r->x) + abs(r->y);
+    if (click.on) {
+        if (d != 0 || r->h != 0 || r->v != 0 || click.held > 0) {
+            click.moved = now;
+        } else if (TIMER_DIFF_32(now, click.moved) >= KEYBALL_CLICK_LAYER_TIMEOUT) {
+            click_layer_off();
+            return;
+        }
+        if (click.lock > 0 && d > 0) {
+            // the report which unlocks passes as is.
+            click.lock = d >= click.lock ? 0 : click.lock - d;
+            if (click.lock > 0) {
+                r->x = 0;
+                r->y = 0;
+            }
+        }
+        return;
+    }
+    // motion is accumulated at any speed, until the trackball stops.
+    if (d == 0) {
+        if (click.motion > 0 && TIMER_DIFF_32(now, click.moved) >= KEYBALL_CLICK_LAYER_WINDOW) {
+            click.motion = 0;
+        }
+        return;
+    }
+    click.moved   = now;
+    click.motion += d;
+    if (click.motion >= keyball.click_threshold) {
+        click.on     = true;
+        click.motion = 0;
+        layer_on(KEYBALL_CLICK_LAYER);
+    }
+}
+
+// click_layer_record keeps the click layer on while mouse keys are held, and
+// turns it off by a pressed key except mouse keys, Keyball keycodes and
+// KEYBALL_CLICK_LAYER_IGNORE_KEYS.
+static void click_layer_record(uint16_t keycode, keyrecord_t *record) {
+    static const uint16_t ignore_keys[] = KEYBALL_CLICK_LAYER_IGNORE_KEYS;
+    bool                  button        = keycode >= KC_MS_BTN1 && keycode <= KC_MS_BTN8;
+    if (button || keycode == SCRL_MO) {
+        if (record->event.pressed) {
+            click.held++;
+            if (button && click.on) {
+                click.lock = KEYBALL_CLICK_LAYER_LOCK;
+            }
+        } else if (click.held > 0 && --click.held == 0) {
+            click.lock  = 0;
+            click.moved = timer_read32();
+        }
+        return;
+    }
+    if (!click.on || !record->event.pressed || IS_QK_KB(keycode)) {
+        return;
+    }
+    for (uint8_t i = 0; i < sizeof(ignore_keys) / sizeof(ignore_keys[0]); i++) {
+        if (keycode == ignore_keys[i]) {
+            return;
+        }
+    }
+    click_layer_off();
+}
+#endif
+
+#ifdef KEYBALL_GESTURE_ENABLE
+// gesture_classify classifies motion to a direction with integers only.
+static keyball_gesture_t gesture_classify(int16_t x, int16_t y) {
+    uint32_t ax = abs(x);
+    uint32_t ay = abs(y);
+#    if KEYBALL_GESTURE_DIRECTIONS == 8
+    // diagonal when the angle from both axes is over 22.5 degrees:
+    // tan(22.5) = 0.414, about 5 / 12.
+    if (ay * 12 > ax * 5 && ax * 12 > ay * 5) {
+        if (y < 0) {
+            return x > 0 ? KEYBALL_GESTURE_UP_RIGHT : KEYBALL_GESTURE_UP_LEFT;
+        }
+        return x > 0 ? KEYBALL_GESTURE_DOWN_RIGHT : KEYBALL_GESTURE_DOWN_LEFT;
+    }
+#    endif
+    if (ax > ay) {
+        return x > 0 ? KEYBALL_GESTURE_RIGHT : KEYBALL_GESTURE_LEFT;
+    }
+    return y < 0 ? KEYBALL_GESTURE_UP : KEYBALL_GESTURE_DOWN;
+}
+
+// gesture_motion takes pointer motion of a mouse report as a gesture in
+// gesture mode.  It takes constant time per report.
+static void gesture_motion(report_mouse_t *r) {
+    if (!gesture.mode) {
+        return;
+    }
+    uint32_t now = timer_read32();
+    if (r->x != 0 || r->y != 0) {
+        gesture.moved = now;
+        if (!gesture.fired) {
+            gesture.x = add16(gesture.x, r->x);
+            gesture.y = add16(gesture.y, r->y);
+            if ((uint16_t)abs(gesture.x) + (uint16_t)abs(gesture.y) >= KEYBALL_GESTURE_THRESHOLD) {
+                gesture.fired = true;
+                keyball_on_gesture(gesture_classify(gesture.x, gesture.y));
+            }
+        }
+    } else if (TIMER_DIFF_32(now, gesture.moved) >= KEYBALL_GESTURE_REARM) {
+        // the trackball stopped: the next motion is a new gesture.
+        gesture.fired = false;
+        gesture.x     = 0;
+        gesture.y     = 0;
+    }
+    r->x = 0;
+    r->y = 0;
+    r->h = 0;
+    r->v = 0;
+}
+#endif
+
+#ifdef KEYBALL_DUAL_GESTURE_ENABLE
+// dual_opposite returns true when motion a and b are opposite, and both are
+// enough to start a dual gesture.
+static bool dual_opposite(int16_t a, int16_t b) {
+    return (a < 0) != (b < 0) && abs(a) >= KEYBALL_DUAL_GESTURE_START && abs(b) >= KEYBALL_DUAL_GESTURE_START;
+}
+
+// dual_gesture_end ends the current dual gesture.
+static void dual_gesture_end(report_mouse_t *r) {
+    if (dual.axis == DUAL_ZOOM) {
+        keyball_on_dual_gesture(KEYBALL_DUAL_GESTURE_ZOOM_END, r);
+    } else if (dual.axis == DUAL_ROTATE) {
+        keyball_on_dual_gesture(KEYBALL_DUAL_GESTURE_ROTATE_END, r);
+    }
+    dual.axis = DUAL_NONE;
+}
+
+// dual_gesture_motion detects opposite motion of both trackballs in a time
+// window, and takes their relative motion as steps of zoom or rotate.  It
+// returns true when motion of trackballs is consumed by a dual gesture.
+// Motion before a gesture is detected moves the pointer or scrolls as usual.
+static bool dual_gesture_motion(report_mouse_t *r) {
+    bool enabled = keyball.this_have_ball && keyball.that_have_ball;
+#    ifdef KEYBALL_GESTURE_ENABLE
+    enabled = enabled && !gesture.mode;
+#    endif
+#    ifdef KEYBALL_KEY_MODE_ENABLE
+    enabled = enabled && keyball_get_key_mode(true) == KEYBALL_KEYS_NONE && keyball_get_key_mode(false) == KEYBALL_KEYS_NONE;
+#    endif
+    if (!enabled) {
+        dual_gesture_end(r);
+        return false;
+    }
+    // peek at pointer motion of both trackballs, in the direction of the
+    // pointer.
+    bool             this_left = is_keyboard_left();
+    report_mouse_t   a = {0}, b = {0};
+    keyball_motion_t m = keyball.this_motion;
+    keyball_on_apply_motion_to_mouse_move(&m, &a, this_left);
+    m = keyball.that_motion;
+    keyball_on_apply_motion_to_mouse_move(&m, &b, !this_left);
+    report_mouse_t *left  = this_left ? &a : &b;
+    report_mouse_t *right = this_left ? &b : &a;
+
+    uint32_t now    = timer_read32();
+    bool     moving = a.x != 0 || a.y != 0 || b.x != 0 || b.y != 0;
+    if (moving) {
+        dual.moved = now;
+    }
+    if (dual.axis == DUAL_NONE) {
+        if (!moving) {
+            return false;
+        }
+        if (TIMER_DIFF_32(now, dual.started) >= KEYBALL_DUAL_GESTURE_WINDOW) {
+            dual.started = now;
+            dual.lx      = 0;
+            dual.ly      = 0;
+            dual.rx      = 0;
+            dual.ry      = 0;
+        }
+        dual.lx = add16(dual.lx, left->x);
+        dual.ly = add16(dual.ly, left->y);
+        dual.rx = add16(dual.rx, right->x);
+        dual.ry = add16(dual.ry, right->y);
+
+        bool zoom   = dual_opposite(dual.lx, dual.rx);
+        bool rotate = dual_opposite(dual.ly, dual.ry);
+        if (zoom && rotate) {
+            // the major axis of relative motion wins.
+            zoom = abs(dual.rx - dual.lx) >= abs(dual.ry - dual.ly);
+        }
+        if (zoom) {
+            dual.axis = DUAL_ZOOM;
+            keyball_on_dual_gesture(KEYBALL_DUAL_GESTURE_ZOOM_START, r);
+        } else if (rotate) {
+            dual.axis = DUAL_ROTATE;
+            keyball_on_dual_gesture(KEYBALL_DUAL_GESTURE_ROTATE_START, r);
+        } else {
+            return false;
+        }
+        dual.rest = 0;
+    } else if (!moving && TIMER_DIFF_32(now, dual.moved) >= KEYBALL_DUAL_GESTURE_WINDOW) {
+        // the next motion starts a new window.
+        dual_gesture_end(r);
+        return false;
+    }
+
+    // consume motion of both trackballs.
+    keyball.this_motion.x = 0;
+    keyball.this_motion.y = 0;
+    keyball.that_motion.x = 0;
+    keyball.that_motion.y = 0;
+    r->x                  = 0;
+    r->y                  = 0;
+    r->h                  = 0;
+    r->v                  = 0;
+    int16_t steps;
+    if (dual.axis == DUAL_ZOOM) {
+        dual.rest = add16(dual.rest, right->x - left->x);
+        steps     = divmod16(&dual.rest, KEYBALL_DUAL_GESTURE_ZOOM_THRESHOLD);
+        for (int16_t i = steps; i != 0; i += steps > 0 ? -1 : 1) {
+            keyball_on_dual_gesture(steps > 0 ? KEYBALL_DUAL_GESTURE_ZOOM_IN : KEYBALL_DUAL_GESTURE_ZOOM_OUT, r);
+        }
+    } else {
+        // left up (negative y) and right down is clockwise.
+        dual.rest = add16(dual.rest, right->y - left->y);
+        steps     = divmod16(&dual.rest, KEYBALL_DUAL_GESTURE_ROTATE_THRESHOLD);
+        for (int16_t i = steps; i != 0; i += steps > 0 ? -1 : 1) {
+            keyball_on_dual_gesture(steps > 0 ? KEYBALL_DUAL_GESTURE_ROTATE_CW : KEYBALL_DUAL_GESTURE_ROTATE_CCW, r);
+        }
+    }
+    return true;
+}
+#endif
+
+#ifdef KEYBALL_KEY_MODE_ENABLE
+// key_mode_tap taps a key for each threshold of motion v, and keeps the rest
+// of it in v.  Motion over KEYBALL_KEY_MODE_MAX_TAPS is dropped.
+static void key_mode_tap(int16_t *v, int16_t threshold, uint8_t keys, uint8_t neg, uint8_t pos) {
+    int16_t taps = divmod16(v, threshold);
+    if (taps == 0) {
+        return;
+    }
+    uint8_t kc = pgm_read_byte(&KEY_MODE_KEYCODES[keys - 1][taps < 0 ? neg : pos]);
+    taps       = abs(taps);
+    if (taps > KEYBALL_KEY_MODE_MAX_TAPS) {
+        taps = KEYBALL_KEY_MODE_MAX_TAPS;
+        *v   = 0;
+    }
+    for (int16_t i = 0; i < taps; i++) {
+        tap_code(kc);
+    }
+}
+
+// key_mode_motion takes motion m of a trackball in key mode as taps of keys.
+// The motion is mapped as pointer by keyball_on_apply_motion_to_mouse_move(),
+// so keys follow the orientation of the trackball, and only the major axis
+// relative to the thresholds taps keys to avoid diagonal noise.
+static void key_mode_motion(keyball_motion_t *m, bool is_left, uint8_t mode) {
+    report_mouse_t r = {0};
+    keyball_on_apply_motion_to_mouse_move(m, &r, is_left);
+    uint8_t i = is_left ? 0 : 1;
+    keys.x[i] = add16(keys.x[i], r.x);
+    keys.y[i] = add16(keys.y[i], r.y);
+    if ((uint32_t)abs(keys.x[i]) * KEYBALL_KEY_MODE_THRESHOLD_Y >= (uint32_t)abs(keys.y[i]) * KEYBALL_KEY_MODE_THRESHOLD_X) {
+        keys.y[i] = 0;
+        key_mode_tap(&keys.x[i], KEYBALL_KEY_MODE_THRESHOLD_X, mode, 2, 3);
+    } else {
+        keys.x[i] = 0;
+        key_mode_tap(&keys.y[i], KEYBALL_KEY_MODE_THRESHOLD_Y, mode, 0, 1);
+    }
+}
+#endif
+
+static void motion_to_mouse(keyball_motion_t *m, report_mouse_t *r, bool is_left, bool as_scroll) {
+#ifdef KEYBALL_KEY_MODE_ENABLE
+    keyball_keys_t mode = keyball_get_key_mode(is_left);
+#    ifdef KEYBALL_GESTURE_ENABLE
+    // gestures take all trackballs.
+    mode = gesture.mode ? KEYBALL_KEYS_NONE : mode;
+#    endif
+    if (mode != KEYBALL_KEYS_NONE) {
+        key_mode_motion(m, is_left, mode);
+        return;
+    }
+#endif
+    // apply to a report of the trackball at first, so motion of trackballs in
+    // the same mode is added up.
+    report_mouse_t t = {0};
+    if (as_scroll) {
+        keyball_on_apply_motion_to_mouse_scroll(m, &t, is_left);
+    } else {
+        keyball_on_apply_motion_to_mouse_move(m, &t, is_left);
+    }
+    // transform in the direction of the pointer: scroll up is pointer up.
+    int16_t x     = as_scroll ? t.h : t.x;
+    int16_t y     = as_scroll ? -t.v : t.y;
+    uint8_t xform = keyball.ball[is_left ? 0 : 1].xform;
+    if (xform & KEYBALL_TRANSFORM_SWAP_XY) {
+        int16_t w = x;
+        x         = y;
+        y         = w;
+    }
+    if (xform & KEYBALL_TRANSFORM_INVERT_X) {
+        x = -x;
+    }
+    if (xform & KEYBALL_TRANSFORM_INVERT_Y) {
+        y = -y;
+    }
+    if (as_scroll) {
+        r->h = clip2int8(r->h + x);
+        r->v = clip2int8(r->v - y);
+    } else {
+        r->x = clip2int8(r->x + x);
+        r->y = clip2int8(r->y + y);
+    }
+}
+
+static inline bool should_report(void) {
+    uint32_t now = timer_read32();
+    // throttling mouse report rate.
+    static uint32_t last = 0;
+    if (keyball.report_interval > 0) {
+        if (TIMER_DIFF_32(now, last) < keyball.report_interval) {
+            return false;
+        }
+        last = now;
+    }
+#if defined(KEYBALL_SCROLLBALL_INHIVITOR) && KEYBALL_SCROLLBALL_INHIVITOR > 0
+    if (TIMER_DIFF_32(now, keyball.scroll_mode_changed) < KEYBALL_SCROLLBALL_INHIVITOR) {
+        keyball.this_motion.x = 0;
+        keyball.this_motion.y = 0;
+        keyball.that_motion.x = 0;
+        keyball.that_motion.y = 0;
+    }
+#endif
+    return true;
+}
+
+#if KEYBALL_SENSOR_VERIFY_INTERVAL > 0
+// verify_sensor checks this sensor keeps its configuration periodically, and
+// restores it after the sensor was reset.
+static void verify_sensor(void) {
+    static uint32_t last = 0;
+    uint32_t        now  = timer_read32();
+    if (TIMER_DIFF_32(now, last) < KEYBALL_SENSOR_VERIFY_INTERVAL) {
+        return;
+    }
+    last = now;
+    if (!sensor_verify()) {
+        dprintf("keyball:verify_sensor: reset detected\n");
+        sensor_recover();
+    }
+}
+#endif
+
+// motion of each sensor of this half at the last poll.
+static keyball_motion_t sensor_motion[SENSOR_COUNT];
+
+#if KEYBALL_SENSOR_MERGE == 1
+static keyball_motion_t sensor_merge_rest;
+#endif
+
+// read_sensors reads motion of all sensors of this half into sensor_motion,
+// and merges it into *m by KEYBALL_SENSOR_MERGE.  It returns true when any
+// sensor has motion.
+static bool read_sensors(keyball_motion_t *m) {
+    sensor_motion_t d[SENSOR_COUNT];
+    uint8_t         mot = sensor_motion_burst_all(d);
+    for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+        sensor_motion[i] = (mot & (1 << i)) ? (keyball_motion_t){d[i].x, d[i].y} : (keyball_motion_t){0};
+    }
+    if (mot == 0) {
+        return false;
+    }
+#if KEYBALL_SENSOR_MERGE == 1
+    // average of sensors with motion, not to be diluted by a sensor losing
+    // the surface.
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+        if (mot & (1 << i)) {
+            sensor_merge_rest.x = add16(sensor_merge_rest.x, sensor_motion[i].x);
+            sensor_merge_rest.y = add16(sensor_merge_rest.y, sensor_motion[i].y);
+            n++;
+        }
+    }
+    m->x = divmod16(&sensor_merge_rest.x, n);
+    m->y = divmod16(&sensor_merge_rest.y, n);
+#else
+    *m = sensor_motion[sensor_primary()];
+#endif
+    return true;
+}
+
+// poll_motion reads motion from sensors of this half.  While the trackball is
+// idle, sensors are polled every KEYBALL_IDLE_POLL_INTERVAL msec instead of
+// every call, and it returns to full rate on the first motion.
+static bool poll_motion(keyball_motion_t *m) {
+#if KEYBALL_IDLE_POLL_INTERVAL > 0
+    static uint32_t last_moved  = 0;
+    static uint32_t last_polled = 0;
+    uint32_t        now         = timer_read32();
+    bool            idle        = TIMER_DIFF_32(now, last_moved) >= KEYBALL_IDLE_POLL_DELAY;
+    if (idle && TIMER_DIFF_32(now, last_polled) < KEYBALL_IDLE_POLL_INTERVAL) {
+        memset(sensor_motion, 0, sizeof(sensor_motion));
+        return false;
+    }
+#    ifdef KEYBALL_TELEMETRY_ENABLE
+    uint32_t gap = TIMER_DIFF_32(now, last_polled);
+    telemetry_count_poll();
+#    endif
+    last_polled = now;
+    if (!read_sensors(m)) {
+        return false;
+    }
+#    ifdef KEYBALL_TELEMETRY_ENABLE
+    if (idle && gap > telemetry.pkt.wake) {
+        // the gap of polls is the latency added to the first motion.
+        telemetry.pkt.wake = MIN(gap, 63);
+    }
+#    endif
+    last_moved = now;
+    return true;
+#else
+#    ifdef KEYBALL_TELEMETRY_ENABLE
+    telemetry_count_poll();
+#    endif
+    return read_sensors(m);
+#endif
+}
+
+report_mouse_t pointing_device_driver_get_report(report_mouse_t rep) {
+    // fetch from optical sensor.
+    if (keyball.this_have_ball) {
+#if KEYBALL_SENSOR_VERIFY_INTERVAL > 0
+        verify_sensor();
+#endif
+        keyball_motion_t d = {0};
+        if (poll_motion(&d)) {
+            ATOMIC_BLOCK_FORCEON {
+                keyball.this_motion.x = add16(keyball.this_motion.x, d.x);
+                keyball.this_motion.y = add16(keyball.this_motion.y, d.y);
+            }
+#ifdef KEYBALL_TELEMETRY_ENABLE
+            telemetry.pkt.this_x = add16(telemetry.pkt.this_x, d.x);
+            telemetry.pkt.this_y = add16(telemetry.pkt.this_y, d.y);
+#endif
+        }
+    }
+    // report mouse event, if keyboard is primary.
+    if (is_keyboard_master() && should_report()) {
+        if (keyball.angle_cal) {
+            angle_calibrate();
+            return rep;
+        }
+        if (keyball.lift_cal) {
+            lift_calibrate();
+            return rep;
+        }
+#ifdef KEYBALL_JITTER_FILTER_ENABLE
+        jitter_filter(&keyball.this_motion, &keyball.this_jitter, ball_scroll(is_keyboard_left(), keyball.scroll_mode));
+        jitter_filter(&keyball.that_motion, &keyball.that_jitter, ball_scroll(!is_keyboard_left(), keyball.scroll_mode));
+#endif
+#ifdef KEYBALL_KINETIC_SCROLL_ENABLE
+        kinetic_scroll(&keyball.this_motion, &keyball.this_kinetic, ball_scroll(is_keyboard_left(), keyball.scroll_mode));
+        kinetic_scroll(&keyball.that_motion, &keyball.that_kinetic, ball_scroll(!is_keyboard_left(), keyball.scroll_mode));
+#endif
+#ifdef KEYBALL_RGB_MOTION_ENABLE
+        motion_peak_update();
+#endif
+        // modify mouse report by sensor motion.
+        bool scroll = keyball.scroll_mode;
+#ifdef KEYBALL_GESTURE_ENABLE
+        // gestures take pointer motion even in scroll mode.
+        scroll = scroll && !gesture.mode;
+#endif
+        bool consumed = false;
+#ifdef KEYBALL_DUAL_GESTURE_ENABLE
+        consumed = dual_gesture_motion(&rep);
+#endif
+        if (!consumed) {
+            motion_to_mouse(&keyball.this_motion, &rep, is_keyboard_left(), ball_scroll(is_keyboard_left(), scroll));
+            motion_to_mouse(&keyball.that_motion, &rep, !is_keyboard_left(), ball_scroll(!is_keyboard_left(), scroll));
+        }
+#ifdef KEYBALL_GESTURE_ENABLE
+        gesture_motion(&rep);
+#endif
+#ifdef KEYBALL_CLICK_LAYER
+        click_layer_motion(&rep);
+#endif
+#ifdef KEYBALL_KINETIC_SCROLL_ENABLE
+        // remember motion left by scroll divider to detect new motion.
+        keyball.this_kinetic.lx = keyball.this_motion.x;
+        keyball.this_kinetic.ly = keyball.this_motion.y;
+        keyball.that_kinetic.lx = keyball.that_motion.x;
+        keyball.that_kinetic.ly = keyball.that_motion.y;
+#endif
+        // store mouse report for OLED.
+        keyball.last_mouse = rep;
+        if (rep.x != 0 || rep.y != 0 || rep.h != 0 || rep.v != 0) {
+            keyball.last_moved = timer_read32();
+#ifdef KEYBALL_TELEMETRY_ENABLE
+            telemetry.pkt.reports++;
+#endif
+        }
+    }
+    return rep;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Split RPC
+
+#ifdef SPLIT_KEYBOARD
+
+// remote is requests from the primary on the secondary.  RPC handlers run in
+// interrupt of the split link, where SPI to the sensor may be in use, so they
+// only record requests and results, and remote_task accesses the sensor.
+static struct {
+    bool             sensor_req; // settings of the sensor are requested
+    keyball_sensor_t sensor;
+    bool             lift_req;   // lift cutoff calibration is requested
+    bool             lift_busy;  // lift cutoff calibration is running
+    int16_t          lift;       // result of lift cutoff calibration
+} remote;
+
+// remote_task writes settings of the sensor and runs lift cutoff calibration
+// requested by the primary, on the secondary.
+static void remote_task(void) {
+    keyball_sensor_t s;
+    bool             sensor_req;
+    bool             lift_req;
+    ATOMIC_BLOCK_FORCEON {
+        s                 = remote.sensor;
+        sensor_req        = remote.sensor_req;
+        lift_req          = remote.lift_req;
+        remote.sensor_req = false;
+        remote.lift_req   = false;
+    }
+    if (!keyball.this_have_ball) {
+        return;
+    }
+    if (sensor_req) {
+        write_sensor(s);
+    }
+    int16_t lift = remote.lift;
+    if (lift_req) {
+        remote.lift_busy = sensor_lift_cal_start();
+        lift             = remote.lift_busy ? -1 : LIFT_CAL_FAILED;
+    } else if (remote.lift_busy) {
+        lift             = sensor_lift_cal_poll();
+        remote.lift_busy = lift < 0;
+    }
+    ATOMIC_BLOCK_FORCEON {
+        // a new request while this ran keeps the result of the request.
+        if (!remote.lift_req) {
+            remote.lift = lift;
+        }
+    }
+}
+
+static void rpc_get_info_handler(uint8_t in_buflen, const void *in_data, uint8_t out_buflen, void *out_data) {
+    keyball_info_t info = {
+        .ballcnt = keyball.this_have_ball ? 1 : 0,
+    };
+    *(keyball_info_t *)out_data = info;
+    keyball_on_adjust_layout(KEYBALL_ADJUST_SECONDARY);
+}
+
+static void rpc_get_info_invoke(void) {
+    static bool     negotiated = false;
+    static uint32_t last_sync  = 0;
+    static int      round      = 0;
+    uint32_t        now        = timer_read32();
+    if (negotiated || TIMER_DIFF_32(now, last_sync) < KEYBALL_TX_GETINFO_INTERVAL) {
+        return;
+    }
+    last_sync = now;
+    round++;
+    keyball_info_t recv = {0};
+    if (!transaction_rpc_exec(KEYBALL_GET_INFO, 0, NULL, sizeof(recv), &recv)) {
+        if (round < KEYBALL_TX_GETINFO_MAXTRY) {
+            dprintf("keyball:rpc_get_info_invoke: missed #%d\n", round);
+            return;
+        }
+    }
+    negotiated             = true;
+    keyball.that_enable    = true;
+    keyball.that_have_ball = recv.ballcnt > 0;
+    dprintf("keyball:rpc_get_info_invoke: negotiated #%d %d\n", round, keyball.that_have_ball);
+
+    // split keyboard negotiation completed.
+
+#    ifdef VIA_ENABLE
+    // adjust VIA layout options according to current combination.
+    uint8_t  layouts = (keyball.this_have_ball ? (is_keyboard_left() ? 0x02 : 0x01) : 0x00) | (keyball.that_have_ball ? (is_keyboard_left() ? 0x01 : 0x02) : 0x00);
+    uint32_t curr    = via_get_layout_options();
+    uint32_t next    = (curr & ~0x3) | layouts;
+    if (next != curr) {
+        via_set_layout_options(next);
+    }
+#    endif
+
+    keyball_on_adjust_layout(KEYBALL_ADJUST_PRIMARY);
+}
+
+static void rpc_get_motion_handler(uint8_t in_buflen, const void *in_data, uint8_t out_buflen, void *out_data) {
+    *(keyball_motion_t *)out_data = keyball.this_motion;
+    // clear motion
+    keyball.this_motion.x = 0;
+    keyball.this_motion.y = 0;
+}
+
+static void rpc_get_motion_invoke(void) {
+    static uint32_t last_sync   = 0;
+    static uint32_t last_motion = 0;
+    uint32_t        now         = timer_read32();
+    uint32_t        interval    = KEYBALL_TX_GETMOTION_INTERVAL;
+#if KEYBALL_TX_GETMOTION_IDLE_INTERVAL > 0
+    if (TIMER_DIFF_32(now, last_motion) >= KEYBALL_IDLE_POLL_DELAY) {
+        interval = KEYBALL_TX_GETMOTION_IDLE_INTERVAL;
+    }
+#endif
+    if (TIMER_DIFF_32(now, last_sync) < interval) {
+        return;
+    }
+    keyball_motion_t recv = {0};
+    if (transaction_rpc_exec(KEYBALL_GET_MOTION, 0, NULL, sizeof(recv), &recv)) {
+        keyball.that_motion.x = add16(keyball.that_motion.x, recv.x);
+        keyball.that_motion.y = add16(keyball.that_motion.y, recv.y);
+        if (recv.x != 0 || recv.y != 0) {
+            last_motion = now;
+        }
+#    ifdef KEYBALL_TELEMETRY_ENABLE
+        telemetry.pkt.link_ok++;
+        telemetry.pkt.that_x = add16(telemetry.pkt.that_x, recv.x);
+        telemetry.pkt.that_y = add16(telemetry.pkt.that_y, recv.y);
+    } else {
+        telemetry.pkt.link_err++;
+#    endif
+    }
+    last_sync = now;
+    return;
+}
+
+// rpc_set_cpi_handler sets CPI of the trackball of the secondary, decided by
+// the primary with settings of the trackball.
+static void rpc_set_cpi_handler(uint8_t in_buflen, const void *in_data, uint8_t out_buflen, void *out_data) {
+    keyball_cpi_t cpi = MIN(*(keyball_cpi_t *)in_data, CPI_MAX);
+    keyball.cpi_value = cpi;
+    if (keyball.this_have_ball) {
+        sensor_cpi_set(cpi == 0 ? CPI_DEFAULT - 1 : cpi - 1);
+    }
+}
+
+static void rpc_set_cpi_invoke(void) {
+    if (!keyball.cpi_changed) {
+        return;
+    }
+    keyball_cpi_t req = ball_cpi(!is_keyboard_left());
+    if (!transaction_rpc_send(KEYBALL_SET_CPI, sizeof(req), &req)) {
+        return;
+    }
+    keyball.cpi_changed = false;
+}
+
+static void rpc_set_sensor_handler(uint8_t in_buflen, const void *in_data, uint8_t out_buflen, void *out_data) {
+    remote.sensor     = *(keyball_sensor_t *)in_data;
+    remote.sensor_req = true;
+}
+
+static void rpc_set_sensor_invoke(void) {
+    if (!keyball.sensor_changed) {
+        return;
+    }
+    keyball_sensor_t req = current_sensor(!is_keyboard_left());
+    if (!transaction_rpc_send(KEYBALL_SET_SENSOR, sizeof(req), &req)) {
+        return;
+    }
+    keyball.sensor_changed = false;
+}
+
+#    ifdef KEYBALL_TELEMETRY_ENABLE
+// rpc_get_stats_handler returns stats sampled before, because this runs in
+// interrupt of the split link and can't access the sensor.  The count of
+// polls is not reset here, so it is consistent however often this is called.
+static void rpc_get_stats_handler(uint8_t in_buflen, const void *in_data, uint8_t out_buflen, void *out_data) {
+    ATOMIC_BLOCK_FORCEON {
+        telemetry.stats.polls = telemetry.pkt.polls;
+    }
+    telemetry.sample = true;
+    *(keyball_stats_t *)out_data = telemetry.stats;
+}
+#    endif
+
+// rpc_cal_lift_handler requests to start lift cutoff calibration, or returns
+// the result of it polled by remote_task.
+static void rpc_cal_lift_handler(uint8_t in_buflen, const void *in_data, uint8_t out_buflen, void *out_data) {
+    if (*(uint8_t *)in_data) {
+        remote.lift_req = true;
+        remote.lift     = -1;
+    }
+    *(int16_t *)out_data = keyball.this_have_ball ? remote.lift : LIFT_CAL_FAILED;
+}
+
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+// Raw HID
+
+#ifdef KEYBALL_HID_ENABLE
+
+#    if !defined(VIA_ENABLE) && !defined(RAW_ENABLE)
+#        error KEYBALL_FRAME_CAPTURE_ENABLE, KEYBALL_TUNING_ENABLE and KEYBALL_TELEMETRY_ENABLE require VIA_ENABLE or RAW_ENABLE.
+#    endif
+
+#    ifdef KEYBALL_FRAME_CAPTURE_ENABLE
+
+#        if !SENSOR_HAS_FRAME
+#            error KEYBALL_FRAME_CAPTURE_ENABLE is not supported by KEYBALL_SENSOR.
+#        endif
+
+// hid_frame_capture sends pixels of a raw frame of the sensor.  The frame is
+// read into RAM at once and sent, or on AVR where it doesn't fit in RAM, the
+// burst read of one capture is kept open while each packet is sent, because
+// nothing else uses SPI meanwhile.  Only the sensor on the USB connected side
+// is supported.
+static void hid_frame_capture(uint8_t *data, uint8_t length) {
+    uint8_t *buf = data + 5;
+    uint8_t  max = length - 5;
+    if (!keyball.this_have_ball || calibrating()) {
+        data[2] = 0xff;
+        data[3] = 0xff;
+        data[4] = 0;
+        raw_hid_send(data, length);
+        return;
+    }
+#        if !defined(__AVR__)
+    static uint8_t frame[SENSOR_FRAME_SIZE];
+    sensor_frame_begin();
+    sensor_frame_read(frame, SENSOR_FRAME_SIZE);
+    sensor_frame_end();
+#        else
+    sensor_frame_begin();
+#        endif
+    for (uint16_t off = 0; off < SENSOR_FRAME_SIZE; off += max) {
+        uint8_t n = MIN(max, SENSOR_FRAME_SIZE - off);
+#        if defined(__AVR__)
+        sensor_frame_read(buf, n);
+#        else
+        memcpy(buf, frame + off, n);
+#        endif
+        memset(buf + n, 0, max - n);
+        data[2] = off & 0xff;
+        data[3] = off >> 8;
+        data[4] = n;
+        raw_hid_send(data, length);
+    }
+#        if defined(__AVR__)
+    sensor_frame_end();
+#        endif
+    // discard motion while capturing.
+    keyball.this_motion = (keyball_motion_t){0};
+}
+
+#    endif
+
+#    ifdef KEYBALL_TUNING_ENABLE
+
+// param_get gets a parameter for tuning.  It returns keyball_param_status.
+static uint8_t param_get(uint8_t id, int16_t *value) {
+    switch (id) {
+        case KEYBALL_PARAM_CPI:
+            *value = keyball.cpi_value;
+            break;
+        case KEYBALL_PARAM_SCROLL_DIV:
+            *value = keyball.scroll_div;
+            break;
+        case KEYBALL_PARAM_SCROLL_MODE:
+            *value = keyball.scroll_mode;
+            break;
+#        if KEYBALL_SCROLLSNAP_ENABLE == 2
+        case KEYBALL_PARAM_SCROLLSNAP_MODE:
+            *value = keyball.scrollsnap_mode;
+            break;
+#        endif
+#        ifdef KEYBALL_KINETIC_SCROLL_ENABLE
+        case KEYBALL_PARAM_KINETIC_SCROLL:
+            *value = keyball.kinetic_level;
+            break;
+#        endif
+#        ifdef POINTING_DEVICE_AUTO_MOUSE_ENABLE
+        case KEYBALL_PARAM_AML_ENABLE:
+            *value = get_auto_mouse_enable();
+            break;
+        case KEYBALL_PARAM_AML_TIMEOUT:
+            *value = get_auto_mouse_timeout();
+            break;
+#        endif
+#        ifdef KEYBALL_CLICK_LAYER
+        case KEYBALL_PARAM_CLICK_LAYER:
+            *value = keyball.click_enable;
+            break;
+        case KEYBALL_PARAM_CLICK_THRESHOLD:
+            *value = keyball.click_threshold;
+            break;
+#        endif
+        case KEYBALL_PARAM_ANGLE_LEFT:
+        case KEYBALL_PARAM_ANGLE_RIGHT:
+            *value = keyball_get_angle(id == KEYBALL_PARAM_ANGLE_LEFT);
+            break;
+        case KEYBALL_PARAM_ANGLE_SNAP:
+            *value = keyball.calib.angle_snap;
+            break;
+        case KEYBALL_PARAM_LIFT_LEFT:
+        case KEYBALL_PARAM_LIFT_RIGHT:
+            *value = keyball_get_lift_cutoff(id == KEYBALL_PARAM_LIFT_LEFT);
+            break;
+        case KEYBALL_PARAM_REPORT_INTERVAL:
+            *value = keyball.report_interval;
+            break;
+        case KEYBALL_PARAM_PROFILE:
+            *value = keyball.profile;
+            break;
+        case KEYBALL_PARAM_BALL_CPI_LEFT:
+        case KEYBALL_PARAM_BALL_CPI_RIGHT:
+            *value = keyball_get_ball(id == KEYBALL_PARAM_BALL_CPI_LEFT).cpi;
+            break;
+        case KEYBALL_PARAM_BALL_SDIV_LEFT:
+        case KEYBALL_PARAM_BALL_SDIV_RIGHT:
+            *value = keyball_get_ball(id == KEYBALL_PARAM_BALL_SDIV_LEFT).sdiv;
+            break;
+        case KEYBALL_PARAM_BALL_MODE_LEFT:
+        case KEYBALL_PARAM_BALL_MODE_RIGHT:
+            *value = keyball_get_ball(id == KEYBALL_PARAM_BALL_MODE_LEFT).mode;
+            break;
+        case KEYBALL_PARAM_BALL_XFORM_LEFT:
+        case KEYBALL_PARAM_BALL_XFORM_RIGHT:
+            *value = keyball_get_ball(id == KEYBALL_PARAM_BALL_XFORM_LEFT).xform;
+            break;
+        case KEYBALL_PARAM_BALLS: {
+            bool left  = is_keyboard_left() ? keyball.this_have_ball : keyball.that_have_ball;
+            bool right = is_keyboard_left() ? keyball.that_have_ball : keyball.this_have_ball;
+            *value     = left | right << 1;
+            break;
+        }
+        default:
+            return id < KEYBALL_PARAM_COUNT ? KEYBALL_PARAM_UNSUPPORTED : KEYBALL_PARAM_UNKNOWN;
+    }
+    return KEYBALL_PARAM_OK;
+}
+
+// param_set sets a parameter for tuning, with same clamping as keycodes.  It
+// returns keyball_param_status.
+static uint8_t param_set(uint8_t id, int16_t value) {
+    int16_t curr;
+    uint8_t status = param_get(id, &curr);
+    if (status != KEYBALL_PARAM_OK) {
+        return status;
+    }
+    uint8_t v = value < 0 ? 0 : MIN(value, 0xff);
+    switch (id) {
+        case KEYBALL_PARAM_CPI:
+            keyball_set_cpi(v);
+            break;
+        case KEYBALL_PARAM_SCROLL_DIV:
+            keyball_set_scroll_div(v);
+            break;
+        case KEYBALL_PARAM_SCROLL_MODE:
+            keyball_set_scroll_mode(v != 0);
+            break;
+#        if KEYBALL_SCROLLSNAP_ENABLE == 2
+        case KEYBALL_PARAM_SCROLLSNAP_MODE:
+            keyball_set_scrollsnap_mode(MIN(v, KEYBALL_SCROLLSNAP_MODE_AUTO));
+            break;
+#        endif
+#        ifdef KEYBALL_KINETIC_SCROLL_ENABLE
+        case KEYBALL_PARAM_KINETIC_SCROLL:
+            keyball_set_kinetic_scroll(v);
+            break;
+#        endif
+#        ifdef POINTING_DEVICE_AUTO_MOUSE_ENABLE
+        case KEYBALL_PARAM_AML_ENABLE:
+            set_auto_mouse_enable(v != 0);
+            break;
+        case KEYBALL_PARAM_AML_TIMEOUT:
+            // quantized as kept in keyball_config_t.
+            value = value / AML_TIMEOUT_QU * AML_TIMEOUT_QU;
+            set_auto_mouse_timeout(MAX(MIN(value, AML_TIMEOUT_MAX), AML_TIMEOUT_MIN));
+            break;
+#        endif
+#        ifdef KEYBALL_CLICK_LAYER
+        case KEYBALL_PARAM_CLICK_LAYER:
+            keyball_set_click_layer(v != 0);
+            break;
+        case KEYBALL_PARAM_CLICK_THRESHOLD:
+            keyball_set_click_threshold(v);
+            break;
+#        endif
+        case KEYBALL_PARAM_ANGLE_LEFT:
+        case KEYBALL_PARAM_ANGLE_RIGHT:
+            keyball_set_angle(id == KEYBALL_PARAM_ANGLE_LEFT, MAX(MIN(value, INT8_MAX), INT8_MIN));
+            break;
+        case KEYBALL_PARAM_ANGLE_SNAP:
+            keyball_set_angle_snap(v != 0);
+            break;
+        case KEYBALL_PARAM_LIFT_LEFT:
+        case KEYBALL_PARAM_LIFT_RIGHT:
+            keyball_set_lift_cutoff(id == KEYBALL_PARAM_LIFT_LEFT, v);
+            break;
+        case KEYBALL_PARAM_REPORT_INTERVAL:
+            keyball_set_report_interval(v);
+            break;
+        case KEYBALL_PARAM_PROFILE:
+            keyball_set_profile(v);
+            break;
+        case KEYBALL_PARAM_BALL_CPI_LEFT ... KEYBALL_PARAM_BALL_XFORM_RIGHT: {
+            // parameters of trackballs are ordered as left and right.
+            bool           is_left = (id - KEYBALL_PARAM_BALL_CPI_LEFT) % 2 == 0;
+            keyball_ball_t ball    = keyball_get_ball(is_left);
+            switch (id) {
+                case KEYBALL_PARAM_BALL_CPI_LEFT:
+                case KEYBALL_PARAM_BALL_CPI_RIGHT:
+                    ball.cpi = v;
+                    break;
+                case KEYBALL_PARAM_BALL_SDIV_LEFT:
+                case KEYBALL_PARAM_BALL_SDIV_RIGHT:
+                    ball.sdiv = v;
+                    break;
+                case KEYBALL_PARAM_BALL_MODE_LEFT:
+                case KEYBALL_PARAM_BALL_MODE_RIGHT:
+                    ball.mode = v;
+                    break;
+                default:
+                    ball.xform = v;
+                    break;
+            }
+            keyball_set_ball(is_left, ball);
+            break;
+        }
+        default:
+            return KEYBALL_PARAM_READONLY;
+    }
+    return KEYBALL_PARAM_OK;
+}
+
+// hid_param processes KEYBALL_HID_PARAM_* commands.
+static void hid_param(uint8_t *data, uint8_t length) {
+    int16_t value = (int16_t)(data[4] | data[5] << 8);
+    switch (data[1]) {
+        case KEYBALL_HID_PARAM_SET:
+            data[3] = param_set(data[2], value);
+            if (data[3] != KEYBALL_PARAM_OK) {
+                break;
+            }
+            // fall through: respond with the applied value.
+        case KEYBALL_HID_PARAM_GET:
+            value   = 0;
+            data[3] = param_get(data[2], &value);
+            break;
+        case KEYBALL_HID_PARAM_SAVE:
+            save_eeprom(EEPROM_CONFIG | EEPROM_CALIB);
+            break;
+    }
+    data[4] = value & 0xff;
+    data[5] = value >> 8;
+    raw_hid_send(data, length);
+}
+
+#        ifdef VIA_ENABLE
+// via_custom_value_command_kb serves parameters to VIA custom menus on
+// id_custom_channel.  Value ID is keyball_param_t.  Values are a byte, or two
+// bytes in big endian for KEYBALL_PARAM_AML_TIMEOUT, as VIA range controls.
+void via_custom_value_command_kb(uint8_t *data, uint8_t length) {
+    // data = [command_id, channel_id, value_id, value_data...]
+    uint8_t  id     = data[2];
+    uint8_t *buf    = data + 3;
+    bool     wide   = id == KEYBALL_PARAM_AML_TIMEOUT;
+    bool     sign   = id == KEYBALL_PARAM_ANGLE_LEFT || id == KEYBALL_PARAM_ANGLE_RIGHT;
+    int16_t  value  = 0;
+    uint8_t  status = KEYBALL_PARAM_UNKNOWN;
+    if (data[1] == id_custom_channel) {
+        switch (data[0]) {
+            case id_custom_set_value:
+                value  = wide ? (int16_t)(buf[0] << 8 | buf[1]) : sign ? (int8_t)buf[0] : buf[0];
+                status = param_set(id, value);
+                break;
+            case id_custom_get_value:
+                status = param_get(id, &value);
+                if (wide) {
+                    buf[0] = value >> 8;
+                    buf[1] = value & 0xff;
+                } else {
+                    buf[0] = value;
+                }
+                break;
+            case id_custom_save:
+                save_eeprom(EEPROM_CONFIG | EEPROM_CALIB);
+                status = KEYBALL_PARAM_OK;
+                break;
+        }
+    }
+    if (status != KEYBALL_PARAM_OK) {
+        data[0] = id_unhandled;
+    }
+}
+#        endif
+
+#    endif
+
+#    ifdef KEYBALL_TELEMETRY_ENABLE
+
+// size of raw HID packets: RAW_EPSIZE.
+#        define TELEMETRY_PACKET_SIZE 32
+
+// hid_telemetry starts, renews or stops telemetry.
+static void hid_telemetry(uint8_t *data, uint8_t length) {
+    if (telemetry.interval == 0) {
+        telemetry.that_valid = false;
+    }
+    telemetry.interval  = data[2] | data[3] << 8;
+    telemetry.requested = timer_read32();
+}
+
+// telemetry_task sends a packet of telemetry every requested interval on the
+// primary, and samples stats of the sensor for the primary on the secondary.
+static void telemetry_task(void) {
+    telemetry.pkt.loops++;
+    if (!is_keyboard_master()) {
+        if (telemetry.sample && keyball.this_have_ball && !calibrating()) {
+            sensor_quality_read(&telemetry.stats.squal, &telemetry.stats.shutter);
+        }
+        telemetry.sample = false;
+        return;
+    }
+    if (telemetry.interval == 0) {
+        return;
+    }
+    uint32_t now = timer_read32();
+    if (TIMER_DIFF_32(now, telemetry.requested) >= KEYBALL_TELEMETRY_TIMEOUT) {
+        telemetry.interval = 0;
+        return;
+    }
+    if (TIMER_DIFF_32(now, telemetry.sent) < telemetry.interval) {
+        return;
+    }
+    telemetry.sent = now;
+
+    keyball_telemetry_t *t = &telemetry.pkt;
+    t->balls               = keyball.this_have_ball | keyball.that_have_ball << 1;
+    t->time                = now;
+    if (keyball.this_have_ball && !calibrating()) {
+        sensor_quality_read(&t->squal, &t->shutter);
+    }
+#        ifdef SPLIT_KEYBOARD
+    keyball_stats_t s = {0};
+    if (keyball.that_have_ball && transaction_rpc_exec(KEYBALL_GET_STATS, 0, NULL, sizeof(s), &s)) {
+        // the first packet has no count to diff with.
+        t->that_polls        = telemetry.that_valid ? s.polls - telemetry.that_polls : 0;
+        t->that_squal        = s.squal;
+        t->that_shutter      = s.shutter;
+        telemetry.that_polls = s.polls;
+        telemetry.that_valid = true;
+    }
+#        endif
+    uint8_t data[TELEMETRY_PACKET_SIZE] = {KEYBALL_HID_PREFIX, KEYBALL_HID_TELEMETRY};
+    memcpy(data + 2, t, sizeof(*t));
+    raw_hid_send(data, sizeof(data));
+
+    uint8_t seq = t->seq + 1;
+    memset(t, 0, sizeof(*t));
+    t->seq = seq;
+}
+
+#    endif
+
+// hid_receive processes a raw HID packet for Keyball.  It returns false when
+// the packet is not for Keyball.
+static bool hid_receive(uint8_t *data, uint8_t length) {
+    if (length < 5 || data[0] != KEYBALL_HID_PREFIX) {
+        return false;
+    }
+    switch (data[1]) {
+#    ifdef KEYBALL_FRAME_CAPTURE_ENABLE
+        case KEYBALL_HID_FRAME_CAPTURE:
+            hid_frame_capture(data, length);
+            return true;
+#    endif
+#    ifdef KEYBALL_TUNING_ENABLE
+        case KEYBALL_HID_PARAM_GET:
+        case KEYBALL_HID_PARAM_SET:
+        case KEYBALL_HID_PARAM_SAVE:
+            hid_param(data, length);
+            return true;
+#    endif
+#    ifdef KEYBALL_TELEMETRY_ENABLE
+        case KEYBALL_HID_TELEMETRY:
+            hid_telemetry(data, length);
+            return true;
+#    endif
+    }
+    return false;
+}
+
+#    ifdef VIA_ENABLE
+bool via_command_kb(uint8_t *data, uint8_t length) {
+    return hid_receive(data, length);
+}
+#    else
+// raw_hid_receive is defined by Keyball without VIA, so keymaps receive other
+// packets by keyball_on_raw_hid_receive() instead.
+void raw_hid_receive(uint8_t *data, uint8_t length) {
+    if (!hid_receive(data, length) && !keyball_on_raw_hid_receive(data, length)) {
+        // reply as unhandled, same as VIA.
+        data[0] = 0xff;
+        raw_hid_send(data, length);
+    }
+}
+#    endif
+
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+// OLED utility
+
+#ifdef OLED_ENABLE
+// clang-format off
 const char PROGMEM code_to_name[] = {
     'a', 'b', 'c', 'd', 'e', 'f',  'g', 'h', 'i',  'j',
     'k', 'l', 'm', 'n', 'o', 'p',  'q', 'r', 's',  't',
@@ -391,6 +2034,74 @@ const char PROGMEM code_to_name[] = {
 // clang-format on
 #endif
 
+#ifdef OLED_ENABLE
+#    define OLED_PANE_BALL 0x01
+#    define OLED_PANE_KEY 0x02
+#    define OLED_PANE_LAYER 0x04
+
+// oled_snap is a snapshot of values drawn by keyball_oled_render_*() last
+// time.  Only cells with changed values are rewritten, and others are skipped
+// by advancing the cursor.
+static struct {
+    uint8_t drawn; // panes drawn at least once: OLED_PANE_*
+
+    // keyball_oled_render_ballinfo()
+    uint8_t cal;
+    uint8_t mouse[4]; // x, y, h, v
+    uint8_t cpi;
+    uint8_t ssnap;
+    uint8_t scroll_mode;
+    uint8_t sdiv;
+
+    // keyball_oled_render_keyinfo()
+    uint8_t row;
+    uint8_t col;
+    uint8_t kc;
+    char    keys[KEYBALL_OLED_MAX_PRESSING_KEYCODES];
+
+    // keyball_oled_render_layerinfo()
+    uint8_t layers; // bit n: layer n is on
+    uint8_t aml;
+    uint8_t aml_to;
+} oled_snap;
+
+// oled_pane_full starts to render a pane.  It returns true when the pane
+// should be rendered fully: not drawn yet, or invalidated.
+static bool oled_pane_full(uint8_t pane) {
+    bool full = (oled_snap.drawn & pane) == 0;
+    oled_snap.drawn |= pane;
+    return full;
+}
+
+// oled_skip advances the cursor over n cells without rewriting them.
+static void oled_skip(uint8_t n) {
+    while (n-- > 0) {
+        oled_advance_char();
+    }
+}
+
+// oled_changed checks a value drawn in n cells.  It returns true when the
+// cells should be rewritten, after updating the snapshot.  Otherwise it skips
+// the cells.
+static bool oled_changed(uint8_t *last, uint8_t v, bool full, uint8_t n) {
+    if (full || *last != v) {
+        *last = v;
+        return true;
+    }
+    oled_skip(n);
+    return false;
+}
+
+// oled_label writes a fixed label of n cells only for full rendering.
+static void oled_label(const char *label, bool full, uint8_t n) {
+    if (full) {
+        oled_write_P(label, false);
+    } else {
+        oled_skip(n);
+    }
+}
+#endif
+
 void keyball_oled_render_ballinfo(void) {
 #ifdef OLED_ENABLE
     // Format: `Ball:{mouse x}{mouse y}{mouse h}{mouse v}`
@@ -398,45 +2109,59 @@ void keyball_oled_render_ballinfo(void) {
     // Output example:
     //
     //     Ball: -12  34   0   0
+    bool full = oled_pane_full(OLED_PANE_BALL);
 
-    // 1st line, "Ball" label, mouse x, y, h, and v.
-    oled_write_P(PSTR("Ball\xB1"), false);
-    oled_write(format_4d(keyball.last_mouse.x), false);
-    oled_write(format_4d(keyball.last_mouse.y), false);
-    oled_write(format_4d(keyball.last_mouse.h), false);
-    oled_write(format_4d(keyball.last_mouse.v), false);
+    // 1st line, "Ball" label ("Cal" while calibrating), mouse x, y, h, and v.
+    if (oled_changed(&oled_snap.cal, calibrating(), full, 5)) {
+        oled_write_P(oled_snap.cal ? PSTR("Cal \xB1") : PSTR("Ball\xB1"), false);
+    }
+    int8_t mouse[4] = {keyball.last_mouse.x, keyball.last_mouse.y, keyball.last_mouse.h, keyball.last_mouse.v};
+    for (uint8_t i = 0; i < 4; i++) {
+        if (oled_changed(&oled_snap.mouse[i], mouse[i], full, 4)) {
+            oled_write(format_4d(mouse[i]), false);
+        }
+    }
 
     // 2nd line, empty label and CPI
-    oled_write_P(PSTR("    \xB1\xBC\xBD"), false);
-    oled_write(format_4d(keyball_get_cpi()) + 1, false);
-    oled_write_P(PSTR("00 "), false);
-
-    // indicate scroll snap mode: "VT" (vertical), "HN" (horiozntal), and "SCR" (free)
-#if 1 && KEYBALL_SCROLLSNAP_ENABLE == 2
-    switch (keyball_get_scrollsnap_mode()) {
-        case KEYBALL_SCROLLSNAP_MODE_VERTICAL:
-            oled_write_P(PSTR("VT"), false);
-            break;
-        case KEYBALL_SCROLLSNAP_MODE_HORIZONTAL:
-            oled_write_P(PSTR("HO"), false);
-            break;
-        default:
-            oled_write_P(PSTR("\xBE\xBF"), false);
-            break;
+    oled_label(PSTR("    \xB1\xBC\xBD"), full, 7);
+    // CPI is unsigned, and exceeds 127 with PMW3389.
+    if (oled_changed(&oled_snap.cpi, keyball_get_cpi(), full, 3)) {
+        oled_write(get_u8_str(oled_snap.cpi, ' '), false);
     }
-#else
-    oled_write_P(PSTR("\xBE\xBF"), false);
-#endif
+    oled_label(PSTR("00 "), full, 3);
+
+    // indicate scroll snap mode: "VT" (vertical), "HN" (horiozntal), "AU"
+    // (automatic), and "SCR" (free)
+#    if 1 && KEYBALL_SCROLLSNAP_ENABLE == 2
+    if (oled_changed(&oled_snap.ssnap, keyball_get_scrollsnap_mode(), full, 2)) {
+        switch (oled_snap.ssnap) {
+            case KEYBALL_SCROLLSNAP_MODE_VERTICAL:
+                oled_write_P(PSTR("VT"), false);
+                break;
+            case KEYBALL_SCROLLSNAP_MODE_HORIZONTAL:
+                oled_write_P(PSTR("HO"), false);
+                break;
+            case KEYBALL_SCROLLSNAP_MODE_AUTO:
+                oled_write_P(PSTR("AU"), false);
+                break;
+            default:
+                oled_write_P(PSTR("\xBE\xBF"), false);
+                break;
+        }
+    }
+#    else
+    oled_label(PSTR("\xBE\xBF"), full, 2);
+#    endif
     // indicate scroll mode: on/off
-    if (keyball.scroll_mode) {
-        oled_write_P(LFSTR_ON, false);
-    } else {
-        oled_write_P(LFSTR_OFF, false);
+    if (oled_changed(&oled_snap.scroll_mode, keyball.scroll_mode, full, 2)) {
+        oled_write_P(oled_snap.scroll_mode ? LFSTR_ON : LFSTR_OFF, false);
     }
 
     // indicate scroll divider:
-    oled_write_P(PSTR(" \xC0\xC1"), false);
-    oled_write_char('0' + keyball_get_scroll_div(), false);
+    oled_label(PSTR(" \xC0\xC1"), full, 3);
+    if (oled_changed(&oled_snap.sdiv, keyball_get_scroll_div(), full, 1)) {
+        oled_write_char('0' + oled_snap.sdiv, false);
+    }
 #endif
 }
 
@@ -460,24 +2185,35 @@ void keyball_oled_render_keyinfo(void) {
     //
     //     Key :  R2  C3 K06 abc
     //     Ball:   0   0   0   0
+    bool full = oled_pane_full(OLED_PANE_KEY);
 
     // "Key" Label
-    oled_write_P(PSTR("Key \xB1"), false);
+    oled_label(PSTR("Key \xB1"), full, 5);
 
     // Row and column
-    oled_write_char('\xB8', false);
-    oled_write_char(to_1x(keyball.last_pos.row), false);
-    oled_write_char('\xB9', false);
-    oled_write_char(to_1x(keyball.last_pos.col), false);
+    oled_label(PSTR("\xB8"), full, 1);
+    if (oled_changed(&oled_snap.row, keyball.last_pos.row, full, 1)) {
+        oled_write_char(to_1x(oled_snap.row), false);
+    }
+    oled_label(PSTR("\xB9"), full, 1);
+    if (oled_changed(&oled_snap.col, keyball.last_pos.col, full, 1)) {
+        oled_write_char(to_1x(oled_snap.col), false);
+    }
 
     // Keycode
-    oled_write_P(PSTR("\xBA\xBB"), false);
-    oled_write_char(to_1x(keyball.last_kc >> 4), false);
-    oled_write_char(to_1x(keyball.last_kc), false);
+    oled_label(PSTR("\xBA\xBB"), full, 2);
+    if (oled_changed(&oled_snap.kc, keyball.last_kc, full, 2)) {
+        oled_write_char(to_1x(oled_snap.kc >> 4), false);
+        oled_write_char(to_1x(oled_snap.kc), false);
+    }
 
     // Pressing keys
-    oled_write_P(PSTR("  "), false);
-    oled_write(keyball.pressing_keys, false);
+    oled_label(PSTR("  "), full, 2);
+    for (uint8_t i = 0; i < KEYBALL_OLED_MAX_PRESSING_KEYCODES; i++) {
+        if (oled_changed((uint8_t *)&oled_snap.keys[i], keyball.pressing_keys[i], full, 1)) {
+            oled_write_char(oled_snap.keys[i], false);
+        }
+    }
 #endif
 }
 
@@ -489,30 +2225,239 @@ void keyball_oled_render_layerinfo(void) {
     //
     //     Layer:-23------------
     //
-    oled_write_P(PSTR("L\xB6\xB7r\xB1"), false);
+    bool full = oled_pane_full(OLED_PANE_LAYER);
+
+    oled_label(PSTR("L\xB6\xB7r\xB1"), full, 5);
+    uint8_t layers = 0;
     for (uint8_t i = 1; i < 8; i++) {
-        oled_write_char((layer_state_is(i) ? to_1x(i) : BL), false);
+        if (layer_state_is(i)) {
+            layers |= 1 << i;
+        }
+    }
+    uint8_t changed = full ? 0xff : layers ^ oled_snap.layers;
+    oled_snap.layers = layers;
+    for (uint8_t i = 1; i < 8; i++) {
+        if (changed & (1 << i)) {
+            oled_write_char((layers & (1 << i) ? to_1x(i) : BL), false);
+        } else {
+            oled_skip(1);
+        }
     }
-    oled_write_char(' ', false);
+    oled_label(PSTR(" "), full, 1);
 
 #    ifdef POINTING_DEVICE_AUTO_MOUSE_ENABLE
-    oled_write_P(PSTR("\xC2\xC3"), false);
-    if (get_auto_mouse_enable()) {
-        oled_write_P(LFSTR_ON, false);
-    } else {
-        oled_write_P(LFSTR_OFF, false);
+    oled_label(PSTR("\xC2\xC3"), full, 2);
+    if (oled_changed(&oled_snap.aml, get_auto_mouse_enable(), full, 2)) {
+        oled_write_P(oled_snap.aml ? LFSTR_ON : LFSTR_OFF, false);
+    }
+
+    if (oled_changed(&oled_snap.aml_to, get_auto_mouse_timeout() / 10, full, 3)) {
+        oled_write(format_4d(oled_snap.aml_to) + 1, false);
+    }
+    oled_label(PSTR("0"), full, 1);
+#    elif defined(KEYBALL_CLICK_LAYER)
+    oled_label(PSTR("\xC2\xC3"), full, 2);
+    if (oled_changed(&oled_snap.aml, keyball.click_enable, full, 2)) {
+        oled_write_P(oled_snap.aml ? LFSTR_ON : LFSTR_OFF, false);
     }
 
-    oled_write(format_4d(get_auto_mouse_timeout() / 10) + 1, false);
-    oled_write_char('0', false);
+    // threshold instead of timeout.
+    if (oled_changed(&oled_snap.aml_to, keyball.click_threshold, full, 3)) {
+        oled_write(get_u8_str(oled_snap.aml_to, ' '), false);
+    }
+    oled_label(PSTR(" "), full, 1);
 #    else
-    oled_write_P(PSTR("\xC2\xC3\xB4\xB5 ---"), false);
+    oled_label(PSTR("\xC2\xC3\xB4\xB5 ---"), full, 8);
+#    endif
+#endif
+}
+
+void keyball_oled_invalidate(void) {
+#ifdef OLED_ENABLE
+    oled_snap.drawn = 0;
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// RGB lighting
+
+#ifdef KEYBALL_RGB_MOTION_ENABLE
+
+#    ifndef RGBLIGHT_ENABLE
+#        error KEYBALL_RGB_MOTION_ENABLE requires RGBLIGHT_ENABLE.
 #    endif
+
+#    define RGB_MOTION_LEVEL_MAX 7
+
+static struct {
+    bool    active; // colors are overridden by motion
+    uint8_t level;  // 0 ~ RGB_MOTION_LEVEL_MAX
+    HSV     base;   // colors set by user, restored after motion
+    HSV     last;   // colors set last time
+    bool    dirty;  // last colors are not written to LEDs yet
+    bool    save;   // base is changed by user, save it to EEPROM on restore
+} rgb_motion;
+
+// rgb_motion_follow applies changes of colors by user while they are
+// overridden to the base colors, as the difference from the colors set last
+// time.  Users change colors from the overridden ones, so the difference is
+// what they meant.
+static void rgb_motion_follow(void) {
+    HSV now = rgblight_get_hsv();
+    if (now.h == rgb_motion.last.h && now.s == rgb_motion.last.s && now.v == rgb_motion.last.v) {
+        return;
+    }
+    rgb_motion.base.h += now.h - rgb_motion.last.h;
+    rgb_motion.base.s = clip2uint8(rgb_motion.base.s + now.s - rgb_motion.last.s);
+    rgb_motion.base.v = clip2uint8(rgb_motion.base.v + now.v - rgb_motion.last.v);
+    rgb_motion.last   = now;
+    rgb_motion.save   = true;
+}
+
+// rgb_motion_request requests to update RGB LEDs in the interval, while they
+// may change.
+static void rgb_motion_request(void) {
+    static uint32_t last = 0;
+    uint32_t        now  = timer_read32();
+    if (TIMER_DIFF_32(now, last) < KEYBALL_RGB_MOTION_INTERVAL) {
+        return;
+    }
+    last = now;
+    if (keyball.motion_peak > 0 || rgb_motion.active || keyball.scroll_mode) {
+        keyball_request_task(KEYBALL_TASK_RGB);
+    }
+}
+
+// rgb_motion_task computes colors of RGB LEDs by speed of trackballs and
+// scroll mode.  Levels of speed rise at once, and fall one by one per update
+// to fade out.  Colors are written by rgb_motion_flush() in the next slice.
+static void rgb_motion_task(void) {
+    if (!rgblight_is_enabled() || rgblight_get_mode() != RGBLIGHT_MODE_STATIC_LIGHT) {
+        keyball.motion_peak = 0;
+        rgb_motion.active   = false;
+        return;
+    }
+    uint8_t level = MIN((uint16_t)keyball.motion_peak * RGB_MOTION_LEVEL_MAX / KEYBALL_RGB_MOTION_SPEED_MAX, RGB_MOTION_LEVEL_MAX);
+    if (level == 0 && keyball.motion_peak > 0) {
+        level = 1;
+    }
+    keyball.motion_peak = 0;
+    if (level < rgb_motion.level) {
+        level = rgb_motion.level - 1;
+    }
+    rgb_motion.level = level;
+
+    if (!rgb_motion.active) {
+        if (level == 0 && !keyball.scroll_mode) {
+            return;
+        }
+        rgb_motion.active = true;
+        rgb_motion.base   = rgblight_get_hsv();
+        rgb_motion.last   = rgb_motion.base;
+    } else if (!rgb_motion.dirty) {
+        rgb_motion_follow();
+    }
+    HSV hsv = rgb_motion.base;
+    if (level == 0 && !keyball.scroll_mode) {
+        rgb_motion.active = false;
+    } else {
+        hsv.h -= level * 6;
+        hsv.v += (uint16_t)(255 - hsv.v) * level / RGB_MOTION_LEVEL_MAX;
+        if (keyball.scroll_mode) {
+            hsv.h += 128;
+        }
+    }
+    // push a frame only when colors change.
+    if (hsv.h != rgb_motion.last.h || hsv.s != rgb_motion.last.s || hsv.v != rgb_motion.last.v) {
+        rgb_motion.last  = hsv;
+        rgb_motion.dirty = true;
+    }
+}
+
+// rgb_motion_flush writes the last colors to RGB LEDs, when they are changed.
+// A frame of WS2812 can't be split, because LEDs latch colors on a pause of
+// the data line, so it takes a slice of its own.  The base colors changed by
+// user are saved to EEPROM when restored, because EEPROM has the overridden
+// colors which user changed.
+static bool rgb_motion_flush(void) {
+    if (!rgb_motion.dirty) {
+        return false;
+    }
+    rgb_motion.dirty = false;
+    if (rgb_motion.save && !rgb_motion.active) {
+        rgb_motion.save = false;
+        rgblight_sethsv(rgb_motion.last.h, rgb_motion.last.s, rgb_motion.last.v);
+        return true;
+    }
+    rgblight_sethsv_noeeprom(rgb_motion.last.h, rgb_motion.last.s, rgb_motion.last.v);
+    return true;
+}
+
+#endif
+
+#if defined(RGB_MATRIX_ENABLE) && defined(RGB_MATRIX_SPLIT)
+
+void keyball_led_map_apply(bool is_left, const keyball_led_t *map, uint8_t count) {
+    const uint8_t split[2] = RGB_MATRIX_SPLIT;
+    uint8_t       base     = is_left ? 0 : split[0];
+    uint8_t       num      = is_left ? split[0] : split[1];
+    uint8_t       row0     = is_left ? 0 : MATRIX_ROWS / 2;
+    memset(g_led_config.matrix_co[row0], NO_LED, sizeof(g_led_config.matrix_co[0]) * MATRIX_ROWS / 2);
+    for (uint8_t i = 0; i < num; i++) {
+        // LEDs missing on this PCB are kept dark by no flags.
+        keyball_led_t led = {KEYBALL_LED_NOKEY, 0, 32, LED_FLAG_NONE};
+        if (i < count) {
+            memcpy_P(&led, &map[i], sizeof(led));
+        }
+        uint8_t index = base + i;
+        if (led.key != KEYBALL_LED_NOKEY) {
+            g_led_config.matrix_co[row0 + (led.key >> 4)][led.key & 0x0f] = index;
+        }
+        g_led_config.point[index].x = is_left ? 112 - led.x : 112 + led.x;
+        g_led_config.point[index].y = led.y;
+        g_led_config.flags[index]   = led.flags;
+    }
+}
+
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+// Public API functions
+
+bool keyball_get_gesture_mode(void) {
+#ifdef KEYBALL_GESTURE_ENABLE
+    return gesture.mode;
+#else
+    return false;
+#endif
+}
+
+void keyball_set_gesture_mode(bool mode) {
+#ifdef KEYBALL_GESTURE_ENABLE
+    gesture.mode  = mode;
+    gesture.fired = false;
+    gesture.x     = 0;
+    gesture.y     = 0;
+#endif
+}
+
+keyball_keys_t keyball_get_key_mode(bool is_left) {
+#ifdef KEYBALL_KEY_MODE_ENABLE
+    uint8_t i = is_left ? 0 : 1;
+    return keys.layer[i] != KEYBALL_KEYS_NONE ? keys.layer[i] : keys.mode[i];
+#else
+    return KEYBALL_KEYS_NONE;
 #endif
 }
 
-//////////////////////////////////////////////////////////////////////////////
-// Public API functions
+void keyball_set_key_mode(bool is_left, keyball_keys_t mode) {
+#ifdef KEYBALL_KEY_MODE_ENABLE
+    uint8_t i    = is_left ? 0 : 1;
+    keys.mode[i] = mode < KEYBALL_KEYS_COUNT ? mode : KEYBALL_KEYS_NONE;
+    keys.x[i]    = 0;
+    keys.y[i]    = 0;
+#endif
+}
 
 bool keyball_get_scroll_mode(void) {
     return keyball.scroll_mode;
@@ -521,6 +2466,9 @@ bool keyball_get_scroll_mode(void) {
 void keyball_set_scroll_mode(bool mode) {
     if (mode != keyball.scroll_mode) {
         keyball.scroll_mode_changed = timer_read32();
+#ifdef KEYBALL_KINETIC_SCROLL_ENABLE
+        kinetic_scroll_cancel();
+#endif
     }
     keyball.scroll_mode = mode;
 }
@@ -539,6 +2487,21 @@ void keyball_set_scrollsnap_mode(keyball_scrollsnap_mode_t mode) {
 #endif
 }
 
+uint8_t keyball_get_kinetic_scroll(void) {
+#ifdef KEYBALL_KINETIC_SCROLL_ENABLE
+    return keyball.kinetic_level;
+#else
+    return 0;
+#endif
+}
+
+void keyball_set_kinetic_scroll(uint8_t level) {
+#ifdef KEYBALL_KINETIC_SCROLL_ENABLE
+    keyball.kinetic_level = level > KINETIC_MAX ? KINETIC_MAX : level;
+    kinetic_scroll_cancel();
+#endif
+}
+
 uint8_t keyball_get_scroll_div(void) {
     return keyball.scroll_div == 0 ? KEYBALL_SCROLL_DIV_DEFAULT : keyball.scroll_div;
 }
@@ -547,6 +2510,66 @@ void keyball_set_scroll_div(uint8_t div) {
     keyball.scroll_div = div > SCROLL_DIV_MAX ? SCROLL_DIV_MAX : div;
 }
 
+void keyball_calibrate_angle(void) {
+    // the sensor should support Angle_Tune.
+    if (SENSOR_MAXANGLE == 0 || calibrating() || (!keyball.this_have_ball && !keyball.that_have_ball)) {
+        return;
+    }
+    keyball.angle_cal   = true;
+    keyball.cal_started = timer_read32();
+    keyball.this_motion = (keyball_motion_t){0};
+    keyball.that_motion = (keyball_motion_t){0};
+    apply_sensor();
+}
+
+int8_t keyball_get_angle(bool is_left) {
+    return keyball.calib.angle[is_left ? 0 : 1];
+}
+
+void keyball_set_angle(bool is_left, int8_t angle) {
+    if (angle > SENSOR_MAXANGLE) {
+        angle = SENSOR_MAXANGLE;
+    } else if (angle < -SENSOR_MAXANGLE) {
+        angle = -SENSOR_MAXANGLE;
+    }
+    keyball.calib.angle[is_left ? 0 : 1] = angle;
+    apply_sensor();
+}
+
+bool keyball_get_angle_snap(void) {
+    return keyball.calib.angle_snap;
+}
+
+void keyball_set_angle_snap(bool enable) {
+    keyball.calib.angle_snap = enable;
+    apply_sensor();
+}
+
+void keyball_calibrate_lift(void) {
+    if (calibrating()) {
+        return;
+    }
+    if (keyball.this_have_ball && sensor_lift_cal_start()) {
+        keyball.lift_cal |= LIFT_CAL_THIS;
+    }
+#ifdef SPLIT_KEYBOARD
+    if (keyball.that_have_ball && lift_cal_remote(true) < 0) {
+        keyball.lift_cal |= LIFT_CAL_THAT;
+    }
+#endif
+    // it is started when sensors support lift cutoff calibration.
+    keyball.cal_started = timer_read32();
+}
+
+uint8_t keyball_get_lift_cutoff(bool is_left) {
+    return keyball.calib.lift[is_left ? 0 : 1];
+}
+
+void keyball_set_lift_cutoff(bool is_left, uint8_t value) {
+    keyball.calib.lift[is_left ? 0 : 1] = value;
+    apply_sensor();
+}
+
 uint8_t keyball_get_cpi(void) {
     return keyball.cpi_value == 0 ? CPI_DEFAULT : keyball.cpi_value;
 }
@@ -558,10 +2581,452 @@ void keyball_set_cpi(uint8_t cpi) {
     keyball.cpi_value   = cpi;
     keyball.cpi_changed = true;
     if (keyball.this_have_ball) {
-        pmw3360_cpi_set(cpi == 0 ? CPI_DEFAULT - 1 : cpi - 1);
+        sensor_cpi_set(ball_cpi(is_keyboard_left()) - 1);
+    }
+}
+
+keyball_ball_t keyball_get_ball(bool is_left) {
+    return keyball.ball[is_left ? 0 : 1];
+}
+
+void keyball_set_ball(bool is_left, keyball_ball_t ball) {
+    ball.cpi   = MIN(ball.cpi, CPI_MAX);
+    ball.sdiv  = MIN(ball.sdiv, SCROLL_DIV_MAX);
+    ball.mode  = ball.mode < KEYBALL_BALL_MODE_COUNT ? ball.mode : KEYBALL_BALL_AUTO;
+    ball.xform = ball.xform & KEYBALL_TRANSFORM_ALL;
+
+    keyball.ball[is_left ? 0 : 1] = ball;
+    // CPI of both trackballs is applied again.
+    keyball_set_cpi(keyball.cpi_value);
+}
+
+keyball_motion_t keyball_get_sensor_motion(uint8_t index) {
+    if (index >= SENSOR_COUNT) {
+        return (keyball_motion_t){0};
+    }
+    return sensor_motion[index];
+}
+
+uint8_t keyball_get_report_interval(void) {
+    return keyball.report_interval;
+}
+
+void keyball_set_report_interval(uint8_t msec) {
+    keyball.report_interval = MIN(msec, REPORT_INT_MAX);
+}
+
+bool keyball_get_click_layer(void) {
+#ifdef KEYBALL_CLICK_LAYER
+    return keyball.click_enable;
+#else
+    return false;
+#endif
+}
+
+void keyball_set_click_layer(bool enable) {
+#ifdef KEYBALL_CLICK_LAYER
+    keyball.click_enable = enable;
+    if (!enable) {
+        click_layer_off();
+    }
+#endif
+}
+
+uint8_t keyball_get_click_threshold(void) {
+#ifdef KEYBALL_CLICK_LAYER
+    return keyball.click_threshold;
+#else
+    return 0;
+#endif
+}
+
+void keyball_set_click_threshold(uint8_t counts) {
+#ifdef KEYBALL_CLICK_LAYER
+    counts                  = MAX(MIN(counts, CLICK_THRESHOLD_MAX), CLICK_THRESHOLD_MIN);
+    keyball.click_threshold = counts / CLICK_THRESHOLD_QU * CLICK_THRESHOLD_QU;
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Persistent store
+
+#define STORE_SLOTS (EECONFIG_KB_DATA_SIZE / sizeof(keyball_store_t))
+
+// bytes written to EEPROM per slice, because EEPROM of ATmega32u4 takes 3.3ms
+// to write a byte.
+#define STORE_CHUNK 1
+
+static struct {
+    keyball_store_t rec;     // configuration to be kept
+    keyball_store_t out;     // record being written
+    uint8_t         slot;    // slot of the latest record
+    uint8_t         seq;     // seq of the latest record
+    uint8_t         pos;     // bytes of out written, 0: not writing
+    bool            dirty;   // rec has changed since out
+    uint32_t        changed; // time when rec changed last
+} store;
+
+static uint32_t config_pack(void) {
+    keyball_config_t c = {
+        .cpi   = keyball.cpi_value,
+        .sdiv  = keyball.scroll_div,
+#ifdef POINTING_DEVICE_AUTO_MOUSE_ENABLE
+        .amle  = get_auto_mouse_enable(),
+        .amlto = (get_auto_mouse_timeout() / AML_TIMEOUT_QU) - 1,
+#endif
+#ifdef KEYBALL_CLICK_LAYER
+        .clkd  = !keyball.click_enable,
+        .clkth = keyball.click_threshold == KEYBALL_CLICK_LAYER_THRESHOLD ? 0 : keyball.click_threshold / CLICK_THRESHOLD_QU,
+#endif
+#if KEYBALL_SCROLLSNAP_ENABLE == 2
+        .ssnap = keyball_get_scrollsnap_mode(),
+#endif
+#ifdef KEYBALL_KINETIC_SCROLL_ENABLE
+        .kscrl = keyball_get_kinetic_scroll() + 1,
+#endif
+#if KEYBALL_SENSOR == 3389
+        .cpi_hi = keyball.cpi_value >> 7,
+#endif
+        .rint  = keyball.report_interval == KEYBALL_REPORTMOUSE_INTERVAL ? 0 : keyball.report_interval + 1,
+    };
+    return c.raw;
+}
+
+// config_apply applies packed configuration.  CPI is set once, so it is
+// written to the sensor and sent to the other half once.
+static void config_apply(uint32_t raw) {
+    keyball_config_t c = {.raw = raw};
+#if KEYBALL_SENSOR == 3389
+    keyball_set_cpi(c.cpi | c.cpi_hi << 7);
+#else
+    keyball_set_cpi(c.cpi);
+#endif
+    keyball_set_scroll_div(c.sdiv);
+#ifdef POINTING_DEVICE_AUTO_MOUSE_ENABLE
+    set_auto_mouse_enable(c.amle);
+    set_auto_mouse_timeout(c.amlto == 0 ? AUTO_MOUSE_TIME : (c.amlto + 1) * AML_TIMEOUT_QU);
+#endif
+#ifdef KEYBALL_CLICK_LAYER
+    keyball_set_click_layer(!c.clkd);
+    keyball_set_click_threshold(c.clkth == 0 ? KEYBALL_CLICK_LAYER_THRESHOLD : c.clkth * CLICK_THRESHOLD_QU);
+#endif
+#if KEYBALL_SCROLLSNAP_ENABLE == 2
+    keyball_set_scrollsnap_mode(c.ssnap);
+#endif
+#ifdef KEYBALL_KINETIC_SCROLL_ENABLE
+    keyball_set_kinetic_scroll(c.kscrl == 0 ? KEYBALL_KINETIC_SCROLL_DEFAULT : c.kscrl - 1);
+#endif
+    keyball_set_report_interval(c.rint == 0 ? KEYBALL_REPORTMOUSE_INTERVAL : c.rint - 1);
+}
+
+static uint8_t *store_addr(uint8_t slot) {
+    return (uint8_t *)EECONFIG_KB_DATABLOCK + slot * sizeof(keyball_store_t);
+}
+
+// store_sum calculates checksum of len bytes of a record.  Rotation detects
+// swapped bytes.
+static uint8_t store_sum(const void *rec, uint8_t len) {
+    const uint8_t *p   = (const uint8_t *)rec;
+    uint8_t        sum = 0x4b;
+    for (uint8_t i = 0; i < len; i++) {
+        sum = (sum << 1 | sum >> 7) + p[i];
+    }
+    return sum;
+}
+
+static void store_touch(void) {
+    store.dirty   = true;
+    store.changed = timer_read32();
+}
+
+// store_migrate takes keyball_config_t in eeconfig_kb saved by older firmware
+// as profile 0.
+static void store_migrate(void) {
+    uint32_t legacy = eeconfig_read_kb();
+    // eeconfig_kb is EECONFIG_KB_DATA_VERSION after EEPROM reset.
+    if (legacy == 0 || legacy == EECONFIG_KB_DATA_VERSION) {
+        return;
+    }
+    dprintf("keyball:store_migrate: %08lx\n", (unsigned long)legacy);
+    store.rec.profile[0] = legacy;
+    store_touch();
+}
+
+// store_load reads the valid record with the latest seq from slots.
+static void store_load(void) {
+    bool found = false;
+    store.slot = STORE_SLOTS - 1;
+    for (uint8_t i = 0; i < STORE_SLOTS; i++) {
+        keyball_store_t rec;
+        eeprom_read_block(&rec, store_addr(i), sizeof(rec));
+        if (rec.version != KEYBALL_STORE_VERSION || rec.sum != store_sum(&rec, offsetof(keyball_store_t, sum))) {
+            continue;
+        }
+        // seq wraps around, compare them by difference.
+        if (found && (int8_t)(rec.seq - store.seq) <= 0) {
+            continue;
+        }
+        found      = true;
+        store.rec  = rec;
+        store.slot = i;
+        store.seq  = rec.seq;
+    }
+    if (!found) {
+        store_migrate();
+    }
+    if (store.rec.profile_id >= KEYBALL_PROFILE_COUNT) {
+        store.rec.profile_id = 0;
+    }
+}
+
+// save_eeprom updates parts of configuration in the record.  It is written to
+// EEPROM later by store_task, not to block the main loop.
+static void save_eeprom(uint8_t parts) {
+    if (parts & EEPROM_CONFIG) {
+        store.rec.profile[keyball.profile] = config_pack();
+        store.rec.profile_id               = keyball.profile;
+        memcpy(store.rec.ball, keyball.ball, sizeof(store.rec.ball));
+    }
+    if (parts & EEPROM_CALIB) {
+        store.rec.calib = keyball.calib;
+    }
+    store_touch();
+}
+
+// store_task requests to write the record, when it has been left unchanged for
+// KEYBALL_STORE_WRITE_DELAY msec.
+static void store_task(void) {
+#ifdef KEYBALL_STORE_AUTOSAVE
+    if (is_keyboard_master() && (store.rec.profile[keyball.profile] != config_pack() || memcmp(&store.rec.calib, &keyball.calib, sizeof(keyball.calib)) != 0 || memcmp(store.rec.ball, keyball.ball, sizeof(keyball.ball)) != 0)) {
+        save_eeprom(EEPROM_CONFIG | EEPROM_CALIB);
+    }
+#endif
+    if (store.dirty && store.pos == 0 && TIMER_DIFF_32(timer_read32(), store.changed) >= KEYBALL_STORE_WRITE_DELAY) {
+        keyball_request_task(KEYBALL_TASK_EEPROM);
+    }
+}
+
+// task_eeprom writes the record to the next slot, STORE_CHUNK bytes per slice.
+static void task_eeprom(void) {
+    uint8_t slot = (store.slot + 1) % STORE_SLOTS;
+    if (store.pos == 0) {
+        store.out         = store.rec;
+        store.out.version = KEYBALL_STORE_VERSION;
+        store.out.seq     = store.seq + 1;
+        store.out.sum     = store_sum(&store.out, offsetof(keyball_store_t, sum));
+        store.dirty       = false;
+    }
+    uint8_t n = sizeof(store.out) - store.pos;
+    if (n > STORE_CHUNK) {
+        n = STORE_CHUNK;
+    }
+    eeprom_update_block((uint8_t *)&store.out + store.pos, store_addr(slot) + store.pos, n);
+    store.pos += n;
+    if (store.pos < sizeof(store.out)) {
+        keyball_request_task(KEYBALL_TASK_EEPROM);
+        return;
+    }
+    store.pos  = 0;
+    store.slot = slot;
+    store.seq  = store.out.seq;
+}
+
+uint8_t keyball_get_profile(void) {
+    return keyball.profile;
+}
+
+void keyball_set_profile(uint8_t id) {
+    if (id >= KEYBALL_PROFILE_COUNT) {
+        return;
+    }
+    keyball.profile = id;
+    config_apply(store.rec.profile[id]);
+}
+
+uint32_t keyball_store_read_user(void) {
+    return store.rec.user;
+}
+
+void keyball_store_update_user(uint32_t value) {
+    if (store.rec.user != value) {
+        store.rec.user = value;
+        store_touch();
+    }
+}
+
+void keyball_save(void) {
+    save_eeprom(EEPROM_CONFIG | EEPROM_CALIB);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Task scheduler
+
+// task_rgb runs a slice of RGB work: writing a frame of lighting by motion,
+// or computing its colors and a slice of keymap's work.  It requests the next
+// slice while any work is left.
+static void task_rgb(void) {
+    static bool more = false; // keymap has work left
+#ifdef KEYBALL_RGB_MOTION_ENABLE
+    if (rgb_motion_flush()) {
+        if (more) {
+            keyball_request_task(KEYBALL_TASK_RGB);
+        }
+        return;
+    }
+    if (is_keyboard_master()) {
+        rgb_motion_task();
+    }
+#endif
+    more = keyball_on_task_rgb();
+#ifdef KEYBALL_RGB_MOTION_ENABLE
+    if (rgb_motion.dirty) {
+        keyball_request_task(KEYBALL_TASK_RGB);
+    }
+#endif
+    if (more) {
+        keyball_request_task(KEYBALL_TASK_RGB);
+    }
+}
+
+static void task_run(keyball_task_t task) {
+    switch (task) {
+        case KEYBALL_TASK_RGB:
+            task_rgb();
+            break;
+        case KEYBALL_TASK_OLED:
+#ifdef OLED_ENABLE
+            oled_set_cursor(0, 0);
+            oled_task_user();
+#endif
+            break;
+        case KEYBALL_TASK_EEPROM:
+            task_eeprom();
+            break;
+        default:
+            break;
+    }
+}
+
+#if KEYBALL_LOOP_BUDGET > 0
+
+static struct {
+    uint16_t loop_start; // usec
+    uint8_t  requested;  // bits of requested tasks
+    uint16_t requested_at[KEYBALL_TASK_COUNT];
+    uint16_t cost[KEYBALL_TASK_COUNT]; // expected cost in usec
+} sched;
+
+// sched_now returns free running time in usec, to measure costs of tasks.
+static uint16_t sched_now(void) {
+#    if defined(__AVR__)
+    // Timer0 runs timer_read32(): it counts at F_CPU / 64, and it is cleared
+    // on compare match every 1ms.
+    uint32_t ms;
+    uint8_t  t;
+    ATOMIC_BLOCK_FORCEON {
+        ms = timer_read32();
+        t  = TCNT0;
+        if (TIFR0 & _BV(OCF0A)) {
+            // cleared, but not counted by the interrupt yet.
+            t = TCNT0;
+            ms++;
+        }
+    }
+    return (uint16_t)ms * 1000 + t * (uint16_t)(64000000UL / F_CPU);
+#    else
+    return TIME_I2US(chVTGetSystemTimeX());
+#    endif
+}
+
+void keyball_request_task(keyball_task_t task) {
+    uint8_t bit = 1 << task;
+    if ((sched.requested & bit) == 0) {
+        sched.requested |= bit;
+        sched.requested_at[task] = timer_read();
+    }
+}
+
+// sched_slice runs the requested task with the highest priority, when it fits
+// in the rest of the loop budget, or it has been deferred too long.  Tasks
+// with lower priority wait for it.
+static void sched_slice(void) {
+    for (uint8_t t = 0; t < KEYBALL_TASK_COUNT; t++) {
+        if ((sched.requested & (1 << t)) == 0) {
+            continue;
+        }
+        uint16_t start = sched_now();
+        if (TIMER_DIFF_16(start, sched.loop_start) + sched.cost[t] > KEYBALL_LOOP_BUDGET && TIMER_DIFF_16(timer_read(), sched.requested_at[t]) < KEYBALL_TASK_MAX_DELAY) {
+            return;
+        }
+        sched.requested &= ~(1 << t);
+        task_run(t);
+        // follow increased cost at once, and decreased one slowly.
+        uint16_t cost = TIMER_DIFF_16(sched_now(), start);
+        if (cost > sched.cost[t]) {
+            sched.cost[t] = cost;
+        } else {
+            sched.cost[t] -= (sched.cost[t] - cost) / 8;
+        }
+        return;
+    }
+}
+
+#    ifdef OLED_ENABLE
+// oled_task_kb does nothing, because OLED is rendered in slices by
+// oled_request().
+bool oled_task_kb(void) {
+    return false;
+}
+
+// oled_request requests to render OLED in the interval, longer while the
+// trackball is moving.
+static void oled_request(void) {
+    static uint32_t last     = 0;
+    uint32_t        now      = timer_read32();
+    uint32_t        interval = KEYBALL_OLED_INTERVAL;
+    if (TIMER_DIFF_32(now, keyball.last_moved) < KEYBALL_OLED_MOVING_INTERVAL) {
+        interval = KEYBALL_OLED_MOVING_INTERVAL;
+    }
+    if (TIMER_DIFF_32(now, last) < interval) {
+        return;
+    }
+    last = now;
+    keyball_request_task(KEYBALL_TASK_OLED);
+}
+#    endif
+
+#else
+
+static struct {
+    uint8_t requested; // bits of slices requested by running tasks
+    bool    running;
+} sched;
+
+void keyball_request_task(keyball_task_t task) {
+    // run at once without scheduler.  Following slices requested by the task
+    // run in next loops.
+    if (sched.running) {
+        sched.requested |= 1 << task;
+        return;
+    }
+    sched.running = true;
+    task_run(task);
+    sched.running = false;
+}
+
+// sched_slice runs one of following slices requested in the last loop.
+static void sched_slice(void) {
+    for (uint8_t t = 0; t < KEYBALL_TASK_COUNT; t++) {
+        if (sched.requested & (1 << t)) {
+            sched.requested &= ~(1 << t);
+            keyball_request_task(t);
+            return;
+        }
     }
 }
 
+#endif
+
 //////////////////////////////////////////////////////////////////////////////
 // Keyboard hooks
 
@@ -572,38 +3037,59 @@ void keyboard_post_init_kb(void) {
         transaction_register_rpc(KEYBALL_GET_INFO, rpc_get_info_handler);
         transaction_register_rpc(KEYBALL_GET_MOTION, rpc_get_motion_handler);
         transaction_register_rpc(KEYBALL_SET_CPI, rpc_set_cpi_handler);
+        transaction_register_rpc(KEYBALL_SET_SENSOR, rpc_set_sensor_handler);
+        transaction_register_rpc(KEYBALL_CAL_LIFT, rpc_cal_lift_handler);
+#    ifdef KEYBALL_TELEMETRY_ENABLE
+        transaction_register_rpc(KEYBALL_GET_STATS, rpc_get_stats_handler);
+#    endif
     }
 #endif
 
     // read keyball configuration from EEPROM
     if (eeconfig_is_enabled()) {
-        keyball_config_t c = {.raw = eeconfig_read_kb()};
-        keyball_set_cpi(c.cpi);
-        keyball_set_scroll_div(c.sdiv);
-#ifdef POINTING_DEVICE_AUTO_MOUSE_ENABLE
-        set_auto_mouse_enable(c.amle);
-        set_auto_mouse_timeout(c.amlto == 0 ? AUTO_MOUSE_TIME : (c.amlto + 1) * AML_TIMEOUT_QU);
-#endif
-#if KEYBALL_SCROLLSNAP_ENABLE == 2
-        keyball_set_scrollsnap_mode(c.ssnap);
-#endif
+        store_load();
+        // settings of trackballs go first, for CPI applied by the profile.
+        memcpy(keyball.ball, store.rec.ball, sizeof(keyball.ball));
+        keyball_set_profile(store.rec.profile_id);
+        keyball.calib = store.rec.calib;
+        apply_sensor();
     }
 
     keyball_on_adjust_layout(KEYBALL_ADJUST_PENDING);
     keyboard_post_init_user();
 }
 
-#if SPLIT_KEYBOARD
 void housekeeping_task_kb(void) {
+#ifdef SPLIT_KEYBOARD
     if (is_keyboard_master()) {
         rpc_get_info_invoke();
         if (keyball.that_have_ball) {
             rpc_get_motion_invoke();
             rpc_set_cpi_invoke();
+            rpc_set_sensor_invoke();
         }
+    } else {
+        remote_task();
     }
-}
 #endif
+#ifdef KEYBALL_RGB_MOTION_ENABLE
+    if (is_keyboard_master()) {
+        rgb_motion_request();
+    }
+#endif
+    store_task();
+#ifdef KEYBALL_TELEMETRY_ENABLE
+    telemetry_task();
+#endif
+#if KEYBALL_LOOP_BUDGET > 0 && defined(OLED_ENABLE)
+    oled_request();
+#endif
+    sched_slice();
+#if KEYBALL_LOOP_BUDGET > 0
+    // next loop starts here.
+    sched.loop_start = sched_now();
+#endif
+}
 
 static void pressing_keys_update(uint16_t keycode, keyrecord_t *record) {
     // Process only valid keycodes.
@@ -625,10 +3111,48 @@ static void pressing_keys_update(uint16_t keycode, keyrecord_t *record) {
     }
 }
 
+#if defined(KEYBALL_PROFILE_LAYERS) || (defined(KEYBALL_KEY_MODE_ENABLE) && defined(KEYBALL_KEY_MODE_LAYERS))
+layer_state_t layer_state_set_kb(layer_state_t state) {
+    uint8_t layer = get_highest_layer(state);
+#    ifdef KEYBALL_PROFILE_LAYERS
+    static const uint8_t layers[] = KEYBALL_PROFILE_LAYERS;
+    _Static_assert(sizeof(layers) <= KEYBALL_PROFILE_COUNT, "KEYBALL_PROFILE_LAYERS has too many layers");
+    // the secondary receives CPI from the primary.
+    for (uint8_t i = 0; is_keyboard_master() && i < sizeof(layers); i++) {
+        if (layers[i] == layer) {
+            if (i != keyball.profile) {
+                keyball_set_profile(i);
+            }
+            break;
+        }
+    }
+#    endif
+#    if defined(KEYBALL_KEY_MODE_ENABLE) && defined(KEYBALL_KEY_MODE_LAYERS)
+    static const uint8_t key_layers[][3] = KEYBALL_KEY_MODE_LAYERS;
+    uint8_t              left = KEYBALL_KEYS_NONE, right = KEYBALL_KEYS_NONE;
+    for (uint8_t i = 0; i < sizeof(key_layers) / sizeof(key_layers[0]); i++) {
+        if (key_layers[i][0] == layer) {
+            left  = key_layers[i][1] < KEYBALL_KEYS_COUNT ? key_layers[i][1] : KEYBALL_KEYS_NONE;
+            right = key_layers[i][2] < KEYBALL_KEYS_COUNT ? key_layers[i][2] : KEYBALL_KEYS_NONE;
+            break;
+        }
+    }
+    if (left != keys.layer[0] || right != keys.layer[1]) {
+        keys.layer[0] = left;
+        keys.layer[1] = right;
+        memset(keys.x, 0, sizeof(keys.x));
+        memset(keys.y, 0, sizeof(keys.y));
+    }
+#    endif
+    return layer_state_set_user(state);
+}
+#endif
+
 #ifdef POINTING_DEVICE_AUTO_MOUSE_ENABLE
 bool is_mouse_record_kb(uint16_t keycode, keyrecord_t* record) {
     switch (keycode) {
         case SCRL_MO:
+        case GEST_MO:
             return true;
     }
     return is_mouse_record_user(keycode, record);
@@ -642,6 +3166,18 @@ bool process_record_kb(uint16_t keycode, keyrecord_t *record) {
 
     pressing_keys_update(keycode, record);
 
+#ifdef KEYBALL_KINETIC_SCROLL_ENABLE
+    // any key press stops kinetic scroll.
+    if (record->event.pressed) {
+        kinetic_scroll_cancel();
+    }
+#endif
+#ifdef KEYBALL_CLICK_LAYER
+    if (is_keyboard_master()) {
+        click_layer_record(keycode, record);
+    }
+#endif
+
     if (!process_record_user(keycode, record)) {
         return false;
     }
@@ -668,33 +3204,39 @@ bool process_record_kb(uint16_t keycode, keyrecord_t *record) {
             // process_auto_mouse may use this in future, if changed order of
             // processes.
             return true;
+
+        case GEST_MO:
+            keyball_set_gesture_mode(record->event.pressed);
+            return true;
     }
 
     // process events which works on pressed only.
     if (record->event.pressed) {
         switch (keycode) {
             case KBC_RST:
+                keyball_set_ball(true, (keyball_ball_t){0});
+                keyball_set_ball(false, (keyball_ball_t){0});
                 keyball_set_cpi(0);
                 keyball_set_scroll_div(0);
+                keyball_set_kinetic_scroll(KEYBALL_KINETIC_SCROLL_DEFAULT);
+                keyball_set_angle_snap(false);
+                keyball_set_report_interval(KEYBALL_REPORTMOUSE_INTERVAL);
 #ifdef POINTING_DEVICE_AUTO_MOUSE_ENABLE
                 set_auto_mouse_enable(false);
                 set_auto_mouse_timeout(AUTO_MOUSE_TIME);
 #endif
-                break;
-            case KBC_SAVE: {
-                keyball_config_t c = {
-                    .cpi   = keyball.cpi_value,
-                    .sdiv  = keyball.scroll_div,
-#ifdef POINTING_DEVICE_AUTO_MOUSE_ENABLE
-                    .amle  = get_auto_mouse_enable(),
-                    .amlto = (get_auto_mouse_timeout() / AML_TIMEOUT_QU) - 1,
-#endif
-#if KEYBALL_SCROLLSNAP_ENABLE == 2
-                    .ssnap = keyball_get_scrollsnap_mode(),
+#ifdef KEYBALL_CLICK_LAYER
+                keyball_set_click_layer(true);
+                keyball_set_click_threshold(KEYBALL_CLICK_LAYER_THRESHOLD);
 #endif
-                };
-                eeconfig_update_kb(c.raw);
-            } break;
+                break;
+            case KBC_SAVE:
+                keyball_save();
+                break;
+
+            case PROF_0 ... PROF_3:
+                keyball_set_profile(keycode - PROF_0);
+                break;
 
             case CPI_I100:
                 add_cpi(1);
@@ -719,6 +3261,35 @@ bool process_record_kb(uint16_t keycode, keyrecord_t *record) {
                 add_scroll_div(-1);
                 break;
 
+#ifdef KEYBALL_KINETIC_SCROLL_ENABLE
+            case SCRL_INI:
+                add_kinetic_scroll(1);
+                break;
+            case SCRL_IND:
+                add_kinetic_scroll(-1);
+                break;
+#endif
+
+            case CAL_ANGL:
+                if (keyball.angle_cal) {
+                    // cancel calibration.
+                    calibration_finish();
+                } else {
+                    keyball_calibrate_angle();
+                }
+                break;
+            case ASNP_TO:
+                keyball_set_angle_snap(!keyball_get_angle_snap());
+                break;
+            case CAL_LIFT:
+                if (keyball.lift_cal) {
+                    // cancel calibration.
+                    calibration_finish();
+                } else {
+                    keyball_calibrate_lift();
+                }
+                break;
+
 #if KEYBALL_SCROLLSNAP_ENABLE == 2
             case SSNP_HOR:
                 keyball_set_scrollsnap_mode(KEYBALL_SCROLLSNAP_MODE_HORIZONTAL);
@@ -729,6 +3300,9 @@ bool process_record_kb(uint16_t keycode, keyrecord_t *record) {
             case SSNP_FRE:
                 keyball_set_scrollsnap_mode(KEYBALL_SCROLLSNAP_MODE_FREE);
                 break;
+            case SSNP_AUT:
+                keyball_set_scrollsnap_mode(KEYBALL_SCROLLSNAP_MODE_AUTO);
+                break;
 #endif
 
 #ifdef POINTING_DEVICE_AUTO_MOUSE_ENABLE
@@ -749,6 +3323,18 @@ bool process_record_kb(uint16_t keycode, keyrecord_t *record) {
                 break;
 #endif
 
+#ifdef KEYBALL_CLICK_LAYER
+            case CLK_TO:
+                keyball_set_click_layer(!keyball.click_enable);
+                break;
+            case CLK_I5:
+                keyball_set_click_threshold(keyball.click_threshold + CLICK_THRESHOLD_QU);
+                break;
+            case CLK_D5:
+                keyball_set_click_threshold(keyball.click_threshold - CLICK_THRESHOLD_QU);
+                break;
+#endif
+
             default:
                 return true;
         }
@@ -49,6 +49,370 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #    define KEYBALL_SCROLLSNAP_TENSION_THRESHOLD 12
 #endif
 
+/// Idle time (msec) to finish a scroll gesture in automatic scroll snap mode.
+/// Next scroll gesture determines the direction again.
+#ifndef KEYBALL_SCROLLSNAP_AUTO_IDLE
+#    define KEYBALL_SCROLLSNAP_AUTO_IDLE 200
+#endif
+
+/// Motion (|x| + |y| counts, before scroll divider) accumulated at the start
+/// of a scroll gesture to determine the direction in automatic scroll snap
+/// mode.
+#ifndef KEYBALL_SCROLLSNAP_AUTO_LOCK_THRESHOLD
+#    define KEYBALL_SCROLLSNAP_AUTO_LOCK_THRESHOLD 8
+#endif
+
+/// Motion (counts, before scroll divider) across the locked direction exceeds
+/// motion along the direction by this value, the direction is determined
+/// again in automatic scroll snap mode.
+#ifndef KEYBALL_SCROLLSNAP_AUTO_UNLOCK_TENSION
+#    define KEYBALL_SCROLLSNAP_AUTO_UNLOCK_TENSION 64
+#endif
+
+/// Define KEYBALL_JITTER_FILTER_ENABLE in your config.h to enable the adaptive
+/// jitter filter for pointer movement.  It smooths motion strongly while the
+/// ball moves slowly, and becomes transparent when the ball moves fast.
+//#define KEYBALL_JITTER_FILTER_ENABLE
+
+/// Smoothed speed (|x| + |y| counts per report) at or below this value is
+/// treated as noise and not reported.  Define 0 to disable the deadband.
+#ifndef KEYBALL_JITTER_DEADBAND
+#    define KEYBALL_JITTER_DEADBAND 2
+#endif
+
+/// Motion in the deadband is held, and reported when it adds up beyond the
+/// deadband or with the next motion out of it.  Motion held longer than this
+/// value (msec) is dropped as noise.
+#ifndef KEYBALL_JITTER_DEADBAND_TIMEOUT
+#    define KEYBALL_JITTER_DEADBAND_TIMEOUT 200
+#endif
+
+/// Weight of a new sample at the lowest speed, in 1/16.  Valid values are
+/// between 1 (strongest smoothing) and 16 (no smoothing).
+#ifndef KEYBALL_JITTER_MIN_ALPHA
+#    define KEYBALL_JITTER_MIN_ALPHA 4
+#endif
+
+/// Speed (|x| + |y| counts per report) at which the filter becomes
+/// transparent.
+#ifndef KEYBALL_JITTER_CUTOFF_SPEED
+#    define KEYBALL_JITTER_CUTOFF_SPEED 24
+#endif
+
+/// Define KEYBALL_KINETIC_SCROLL_ENABLE in your config.h to enable kinetic
+/// (inertial) scroll.  Scroll continues with decaying speed after the ball is
+/// released at speed in scroll mode.
+//#define KEYBALL_KINETIC_SCROLL_ENABLE
+
+/// Default level of kinetic scroll inertia.  Valid values are between 0 (off)
+/// and 6 (longest glide).  See also keyball_set_kinetic_scroll().
+#ifndef KEYBALL_KINETIC_SCROLL_DEFAULT
+#    define KEYBALL_KINETIC_SCROLL_DEFAULT 3
+#endif
+
+/// Minimum speed (|x| + |y| counts per report, before scroll divider) at
+/// release to start kinetic scroll.
+#ifndef KEYBALL_KINETIC_SCROLL_THRESHOLD
+#    define KEYBALL_KINETIC_SCROLL_THRESHOLD 24
+#endif
+
+/// Define KEYBALL_CLICK_LAYER in your config.h as a layer number to enable
+/// the click layer, an automatic mouse layer triggered by distance.  The layer
+/// is turned on when the trackball moves the pointer by the threshold, and
+/// turned off after KEYBALL_CLICK_LAYER_TIMEOUT msec without motion, or by a
+/// key other than mouse buttons, Keyball keycodes and
+/// KEYBALL_CLICK_LAYER_IGNORE_KEYS.  It can't be used with
+/// POINTING_DEVICE_AUTO_MOUSE_ENABLE.
+//#define KEYBALL_CLICK_LAYER 6
+
+/// Default motion (|x| + |y| counts) to turn on the click layer.  Valid values
+/// are between 5 and 155.  See also keyball_set_click_threshold().
+#ifndef KEYBALL_CLICK_LAYER_THRESHOLD
+#    define KEYBALL_CLICK_LAYER_THRESHOLD 50
+#endif
+
+/// Motion towards the threshold is discarded when the trackball stops for
+/// this msec, so separate touches of the trackball don't add up to it.
+#ifndef KEYBALL_CLICK_LAYER_WINDOW
+#    define KEYBALL_CLICK_LAYER_WINDOW 50
+#endif
+
+#ifndef KEYBALL_CLICK_LAYER_TIMEOUT
+#    define KEYBALL_CLICK_LAYER_TIMEOUT 1000
+#endif
+
+/// While a mouse button is held on the click layer, pointer motion is dropped
+/// until the trackball moves this counts, not to drag by clicking.  Define 0
+/// to disable.
+#ifndef KEYBALL_CLICK_LAYER_LOCK
+#    define KEYBALL_CLICK_LAYER_LOCK 30
+#endif
+
+/// Keys which don't turn off the click layer, to click with modifiers.
+#ifndef KEYBALL_CLICK_LAYER_IGNORE_KEYS
+#    define KEYBALL_CLICK_LAYER_IGNORE_KEYS { KC_LCTL, KC_LSFT, KC_LALT, KC_LGUI, KC_RCTL, KC_RSFT, KC_RALT, KC_RGUI }
+#endif
+
+/// Define KEYBALL_GESTURE_ENABLE in your config.h to enable gestures: while
+/// GEST_MO is held, a flick of the trackball sends a keycode by its direction
+/// instead of moving the pointer.  See keyball_on_gesture().
+//#define KEYBALL_GESTURE_ENABLE
+
+/// Directions of gestures: 4 (up, right, down and left) or 8 (with
+/// diagonals).
+#ifndef KEYBALL_GESTURE_DIRECTIONS
+#    define KEYBALL_GESTURE_DIRECTIONS 4
+#endif
+
+/// Motion (|x| + |y| counts of the pointer) of a flick to be a gesture.
+#ifndef KEYBALL_GESTURE_THRESHOLD
+#    define KEYBALL_GESTURE_THRESHOLD 100
+#endif
+
+/// After a gesture, the trackball should stop for this msec before the next
+/// gesture, so a flick sends one keycode.  Motion which doesn't reach the
+/// threshold is discarded too.
+#ifndef KEYBALL_GESTURE_REARM
+#    define KEYBALL_GESTURE_REARM 100
+#endif
+
+/// Keycodes sent by gestures, in keyball_gesture_t order: clockwise from up.
+/// Diagonals are ignored when KEYBALL_GESTURE_DIRECTIONS is 4.
+#ifndef KEYBALL_GESTURE_KEYCODES
+#    define KEYBALL_GESTURE_KEYCODES { KC_PGUP, KC_NO, KC_WFWD, KC_NO, KC_PGDN, KC_NO, KC_WBAK, KC_NO }
+#endif
+
+/// Define KEYBALL_KEY_MODE_ENABLE in your config.h to enable key mode of
+/// trackballs: motion of a trackball in key mode is sent as taps of arrow,
+/// page or volume keys instead of moving the pointer or scrolling.  It is
+/// selected per trackball by keyball_set_key_mode() or
+/// KEYBALL_KEY_MODE_LAYERS.
+//#define KEYBALL_KEY_MODE_ENABLE
+
+/// Define KEYBALL_KEY_MODE_LAYERS in your config.h to select key mode by
+/// layers.  Each entry is { layer, left ball, right ball } with
+/// keyball_keys_t, applied while the layer is the highest active layer.
+/// KEYBALL_KEYS_NONE keeps the mode set by keyball_set_key_mode().
+//#define KEYBALL_KEY_MODE_LAYERS { { 3, KEYBALL_KEYS_ARROW, KEYBALL_KEYS_ARROW }, { 4, KEYBALL_KEYS_VOLUME, KEYBALL_KEYS_PAGE } }
+
+/// Motion (pointer counts) per tap on each axis in key mode.
+#ifndef KEYBALL_KEY_MODE_THRESHOLD_X
+#    define KEYBALL_KEY_MODE_THRESHOLD_X 40
+#endif
+
+#ifndef KEYBALL_KEY_MODE_THRESHOLD_Y
+#    define KEYBALL_KEY_MODE_THRESHOLD_Y 40
+#endif
+
+/// Taps per mouse report at most in key mode.  Fast motion taps more keys per
+/// report up to this, and motion over it is dropped, so keys don't continue
+/// after the trackball stops.
+#ifndef KEYBALL_KEY_MODE_MAX_TAPS
+#    define KEYBALL_KEY_MODE_MAX_TAPS 4
+#endif
+
+/// Keycodes of key mode, in keyball_keys_t order from KEYBALL_KEYS_ARROW:
+/// { up, down, left, right } for each.  They are sent by tap_code(), so basic
+/// and media keycodes are supported.
+#ifndef KEYBALL_KEY_MODE_KEYCODES
+#    define KEYBALL_KEY_MODE_KEYCODES { { KC_UP, KC_DOWN, KC_LEFT, KC_RGHT }, { KC_PGUP, KC_PGDN, KC_HOME, KC_END }, { KC_VOLU, KC_VOLD, KC_MPRV, KC_MNXT } }
+#endif
+
+/// Define KEYBALL_DUAL_GESTURE_ENABLE in your config.h to enable gestures by
+/// both trackballs: rolling them apart or together sends zoom, and rolling
+/// one up and the other down sends rotate.  It works only when both halves
+/// have a trackball.  See keyball_on_dual_gesture().
+//#define KEYBALL_DUAL_GESTURE_ENABLE
+
+/// Motion (pointer counts) of each trackball in opposite directions within
+/// KEYBALL_DUAL_GESTURE_WINDOW msec to start a dual gesture.
+#ifndef KEYBALL_DUAL_GESTURE_START
+#    define KEYBALL_DUAL_GESTURE_START 20
+#endif
+
+/// Time window (msec) to detect a dual gesture.  A dual gesture ends when
+/// both trackballs stop for this time.
+#ifndef KEYBALL_DUAL_GESTURE_WINDOW
+#    define KEYBALL_DUAL_GESTURE_WINDOW 100
+#endif
+
+/// Relative motion (pointer counts) of two trackballs per step of zoom.
+#ifndef KEYBALL_DUAL_GESTURE_ZOOM_THRESHOLD
+#    define KEYBALL_DUAL_GESTURE_ZOOM_THRESHOLD 40
+#endif
+
+/// Relative motion (pointer counts) of two trackballs per step of rotate.
+#ifndef KEYBALL_DUAL_GESTURE_ROTATE_THRESHOLD
+#    define KEYBALL_DUAL_GESTURE_ROTATE_THRESHOLD 80
+#endif
+
+/// Modifiers held while zooming, with wheel in mouse reports.
+#ifndef KEYBALL_DUAL_GESTURE_ZOOM_MODS
+#    define KEYBALL_DUAL_GESTURE_ZOOM_MODS MOD_BIT(KC_LCTL)
+#endif
+
+/// Keycodes sent by a step of rotate: { clockwise, counterclockwise }.  There
+/// is no common shortcut of rotate, so nothing is sent by default.
+#ifndef KEYBALL_DUAL_GESTURE_ROTATE_KEYCODES
+#    define KEYBALL_DUAL_GESTURE_ROTATE_KEYCODES { KC_NO, KC_NO }
+#endif
+
+/// Motion (|x| + |y| counts) to be rolled straight up to finish angle
+/// calibration.  See also keyball_calibrate_angle().
+#ifndef KEYBALL_ANGLE_CAL_DISTANCE
+#    define KEYBALL_ANGLE_CAL_DISTANCE 1000
+#endif
+
+/// Angle calibration is aborted when the trackball is not rolled enough in
+/// this time (msec).
+#ifndef KEYBALL_ANGLE_CAL_TIMEOUT
+#    define KEYBALL_ANGLE_CAL_TIMEOUT 10000
+#endif
+
+/// Lift cutoff calibration is aborted when the sensors don't finish it in this
+/// time (msec).  See also keyball_calibrate_lift().
+#ifndef KEYBALL_LIFT_CAL_TIMEOUT
+#    define KEYBALL_LIFT_CAL_TIMEOUT 15000
+#endif
+
+/// Rest mode profile of trackball sensors.  The sensors lower their frame
+/// rate step by step in rest modes while no motion, to save power.
+///
+/// - 0: rest modes are disabled, the sensors always run at full rate.
+/// - 1: balanced, timing of the sensor defaults: Rest1 (1ms) after 0.5s,
+///      Rest2 (100ms) after 10s, and Rest3 (500ms) after 10min.
+/// - 2: power saving: Rest1 (2ms) after 0.1s, Rest2 (50ms) after 3s, and
+///      Rest3 (200ms) after 30s.
+#ifndef KEYBALL_REST_PROFILE
+#    define KEYBALL_REST_PROFILE 0
+#endif
+
+/// After the trackball is idle for KEYBALL_IDLE_POLL_DELAY msec, its sensor is
+/// polled every KEYBALL_IDLE_POLL_INTERVAL msec instead of every scan, to
+/// reduce SPI transactions.  It returns to full rate on the first motion,
+/// which is delayed up to the interval.  It is disabled by default (0):
+/// define KEYBALL_IDLE_POLL_INTERVAL in msec, like 4, to enable.
+#ifndef KEYBALL_IDLE_POLL_INTERVAL
+#    define KEYBALL_IDLE_POLL_INTERVAL 0
+#endif
+
+#ifndef KEYBALL_IDLE_POLL_DELAY
+#    define KEYBALL_IDLE_POLL_DELAY 1000
+#endif
+
+/// After the trackball on the other half is idle for KEYBALL_IDLE_POLL_DELAY
+/// msec, its motion is fetched every KEYBALL_TX_GETMOTION_IDLE_INTERVAL msec
+/// instead of every KEYBALL_TX_GETMOTION_INTERVAL msec, to free the split link
+/// which blocks interrupts while transferring on ATmega32u4.  Its effect is
+/// estimated, not measured.  Define 0 to disable.
+#ifndef KEYBALL_TX_GETMOTION_IDLE_INTERVAL
+#    if defined(MCU_RP)
+#        define KEYBALL_TX_GETMOTION_IDLE_INTERVAL 0 // PIO serial runs in background
+#    else
+#        define KEYBALL_TX_GETMOTION_IDLE_INTERVAL 16
+#    endif
+#endif
+
+/// Trackball sensors are verified in this interval (msec), and restored when
+/// they seem to have been reset by ESD or brown-out.  It is disabled by
+/// default (0): define it like 5000 to enable.
+#ifndef KEYBALL_SENSOR_VERIFY_INTERVAL
+#    define KEYBALL_SENSOR_VERIFY_INTERVAL 0
+#endif
+
+/// Slow tasks: RGB LED updates, OLED rendering and EEPROM writes, are run in
+/// slices at the end of the main loop, after trackballs and the matrix are
+/// processed.  One task per loop is run in this order of priority, only when
+/// the loop has spent less than KEYBALL_LOOP_BUDGET usec including expected
+/// cost of the task.  Otherwise the task is deferred to following loops, up to
+/// KEYBALL_TASK_MAX_DELAY msec.  It is disabled by default (0): define
+/// KEYBALL_LOOP_BUDGET in usec, like 2000, to enable.  Then OLED is rendered by
+/// the scheduler instead of oled_task_kb().
+#ifndef KEYBALL_LOOP_BUDGET
+#    define KEYBALL_LOOP_BUDGET 0
+#endif
+
+#ifndef KEYBALL_TASK_MAX_DELAY
+#    define KEYBALL_TASK_MAX_DELAY 100
+#endif
+
+/// OLED is rendered every KEYBALL_OLED_INTERVAL msec, or every
+/// KEYBALL_OLED_MOVING_INTERVAL msec while the trackball is moving, because
+/// each render sends changed blocks over I2C in following loops.  These work
+/// when KEYBALL_LOOP_BUDGET is enabled.
+#ifndef KEYBALL_OLED_INTERVAL
+#    define KEYBALL_OLED_INTERVAL 50
+#endif
+
+#ifndef KEYBALL_OLED_MOVING_INTERVAL
+#    define KEYBALL_OLED_MOVING_INTERVAL 200
+#endif
+
+/// Define KEYBALL_RGB_MOTION_ENABLE in your config.h to light RGB LEDs by
+/// motion of trackballs.  It requires RGBLIGHT_ENABLE, and works only in
+/// static light mode: LEDs get brighter and warmer with speed, and shift hue
+/// in scroll mode.  LEDs are updated only when colors change, and at most
+/// every KEYBALL_RGB_MOTION_INTERVAL msec.
+//#define KEYBALL_RGB_MOTION_ENABLE
+
+#ifndef KEYBALL_RGB_MOTION_INTERVAL
+#    define KEYBALL_RGB_MOTION_INTERVAL 50
+#endif
+
+/// Speed (|x| + |y| counts per report) to light LEDs at full level.
+#ifndef KEYBALL_RGB_MOTION_SPEED_MAX
+#    define KEYBALL_RGB_MOTION_SPEED_MAX 40
+#endif
+
+/// Configuration is written to EEPROM KEYBALL_STORE_WRITE_DELAY msec after
+/// its last change, so changes in a row are coalesced into one write.  Each
+/// write goes to the next slot of the keyboard level data block of EEPROM
+/// (EECONFIG_KB_DATA_SIZE / sizeof(keyball_store_t) slots) to level wear.
+#ifndef KEYBALL_STORE_WRITE_DELAY
+#    define KEYBALL_STORE_WRITE_DELAY 1000
+#endif
+
+/// Define KEYBALL_STORE_AUTOSAVE in your config.h to save configuration
+/// changed by keycodes or API automatically, without KBC_SAVE.
+//#define KEYBALL_STORE_AUTOSAVE
+
+/// Define KEYBALL_PROFILE_LAYERS in your config.h to switch profiles by
+/// layers.  It lists layers for profiles from 0: { 0, 3 } applies profile 1
+/// while layer 3 is the highest active layer, and profile 0 on layer 0.  Other
+/// layers keep the current profile.
+//#define KEYBALL_PROFILE_LAYERS { 0, 3 }
+
+/// Define KEYBALL_FRAME_CAPTURE_ENABLE in your config.h to enable capture of
+/// raw frames of the trackball sensor over raw HID, for diagnostics of dirt or
+/// focus.  It requires RAW_ENABLE or VIA_ENABLE.  See bin/keyball-frame.py for
+/// the viewer on host.
+//#define KEYBALL_FRAME_CAPTURE_ENABLE
+
+/// Define KEYBALL_TUNING_ENABLE in your config.h to get and set parameters
+/// (keyball_param_t) over raw HID or VIA custom menus, to tune and audit
+/// keyboards without reflash.  It requires RAW_ENABLE or VIA_ENABLE.  See
+/// bin/keyball-tune.py for the tool on host.
+//#define KEYBALL_TUNING_ENABLE
+
+/// Define KEYBALL_TELEMETRY_ENABLE in your config.h to stream statistics of
+/// trackball sensors and the split link (keyball_telemetry_t) over raw HID
+/// while the host requests.  It requires RAW_ENABLE or VIA_ENABLE.  See
+/// bin/keyball-telemetry.py for the recorder on host.
+//#define KEYBALL_TELEMETRY_ENABLE
+
+/// Telemetry stops when the host hasn't renewed its request for this msec,
+/// not to block on raw HID after the recorder was gone.
+#ifndef KEYBALL_TELEMETRY_TIMEOUT
+#    define KEYBALL_TELEMETRY_TIMEOUT 5000
+#endif
+
+/// Optical sensor of trackball: 3360 (PMW3360, default), 3389 (PMW3389) or
+/// 3610 (PMW3610).  Set KEYBALL_SENSOR in your rules.mk to select its driver,
+/// which defines this.  Some features depend on the sensor: see sensor.h.
+#ifndef KEYBALL_SENSOR
+#    define KEYBALL_SENSOR 3360
+#endif
+
 /// Specify SROM ID to be uploaded PMW3360DW (optical sensor).  It will be
 /// enabled high CPI setting or so.  Valid valus are 0x04 or 0x81.  Define this
 /// in your config.h to be enable.  Please note that using this option will
@@ -56,6 +420,22 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //#define KEYBALL_PMW3360_UPLOAD_SROM_ID 0x04
 //#define KEYBALL_PMW3360_UPLOAD_SROM_ID 0x81
 
+/// PMW3389 requires SROM at power up, so the one bundled with QMK
+/// (drivers/sensors/pmw3389_firmware.h) is uploaded by default.  Define 0 to
+/// skip it and save about 4KB: lift cutoff calibration is disabled then.
+#ifndef KEYBALL_PMW3389_UPLOAD_SROM
+#    define KEYBALL_PMW3389_UPLOAD_SROM 1
+#endif
+
+/// Motion of several sensors of a half (PMW33XX_NCS_PINS) is merged into the
+/// trackball by this way: 0 takes only the primary sensor, the first present
+/// one, and others are left for keyball_get_sensor_motion(), to detect twist
+/// of the ball for example.  1 takes the average of sensors with motion, to
+/// tolerate a sensor losing the surface.
+#ifndef KEYBALL_SENSOR_MERGE
+#    define KEYBALL_SENSOR_MERGE 0
+#endif
+
 /// Defining this macro keeps two functions intact: keycode_config() and
 /// mod_config() in keycode_config.c.
 ///
@@ -70,7 +450,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #define KEYBALL_TX_GETINFO_INTERVAL 500
 #define KEYBALL_TX_GETINFO_MAXTRY 10
-#define KEYBALL_TX_GETMOTION_INTERVAL 4
+#if defined(MCU_RP)
+#    define KEYBALL_TX_GETMOTION_INTERVAL 1 // follows 1 kHz mouse reports
+#else
+#    define KEYBALL_TX_GETMOTION_INTERVAL 4
+#endif
 
 #if (PRODUCT_ID & 0xff00) == 0x0000
 #    define KEYBALL_MODEL 46
@@ -86,6 +470,15 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #define KEYBALL_OLED_MAX_PRESSING_KEYCODES 6
 
+// First byte of raw HID packets for Keyball.  It doesn't conflict with
+// command IDs of VIA.
+#define KEYBALL_HID_PREFIX 0x4B // 'K'
+
+// KEYBALL_HID_ENABLE is defined when any feature over raw HID is enabled.
+#if defined(KEYBALL_FRAME_CAPTURE_ENABLE) || defined(KEYBALL_TUNING_ENABLE) || defined(KEYBALL_TELEMETRY_ENABLE)
+#    define KEYBALL_HID_ENABLE
+#endif
+
 //////////////////////////////////////////////////////////////////////////////
 // Types
 
@@ -108,6 +501,17 @@ enum keyball_keycodes {
     SSNP_VRT = QK_KB_13, // Set scroll snap mode as vertical
     SSNP_HOR = QK_KB_14, // Set scroll snap mode as horizontal
     SSNP_FRE = QK_KB_15, // Set scroll snap mode as disable (free scroll)
+    SSNP_AUT = QK_KB_18, // Set scroll snap mode as automatic
+
+    // Kinetic scroll control keycodes.
+    // Only works when KEYBALL_KINETIC_SCROLL_ENABLE is defined.
+    SCRL_INI = QK_KB_16, // Increment kinetic scroll inertia
+    SCRL_IND = QK_KB_17, // Decrement kinetic scroll inertia (0: off)
+
+    // Trackball sensor calibration keycodes.
+    CAL_ANGL = QK_KB_19, // Calibrate angle: roll trackball straight up
+    ASNP_TO  = QK_KB_20, // Toggle angle snap of trackball sensor
+    CAL_LIFT = QK_KB_21, // Calibrate lift cutoff: roll trackball around
 
     // Auto mouse layer control keycodes.
     // Only works when POINTING_DEVICE_AUTO_MOUSE_ENABLE is defined.
@@ -115,6 +519,21 @@ enum keyball_keycodes {
     AML_I50  = QK_KB_11, // Increment automatic mouse layer timeout
     AML_D50  = QK_KB_12, // Decrement automatic mouse layer timeout
 
+    // Profile keycodes: apply a stored profile of configuration.
+    PROF_0   = QK_KB_22, // Apply profile 0
+    PROF_1   = QK_KB_23, // Apply profile 1
+    PROF_2   = QK_KB_24, // Apply profile 2
+    PROF_3   = QK_KB_25, // Apply profile 3
+
+    // Click layer control keycodes.
+    // Only works when KEYBALL_CLICK_LAYER is defined.
+    CLK_TO   = QK_KB_26, // Toggle click layer
+    CLK_I5   = QK_KB_27, // Increment click layer threshold
+    CLK_D5   = QK_KB_28, // Decrement click layer threshold
+
+    // Only works when KEYBALL_GESTURE_ENABLE is defined.
+    GEST_MO  = QK_KB_29, // Momentary gesture mode
+
     // User customizable 32 keycodes.
     KEYBALL_SAFE_RANGE = QK_USER_0,
 };
@@ -128,14 +547,25 @@ typedef union {
         uint8_t amle : 1;  // automatic mouse layer enabled
         uint16_t amlto : 5; // automatic mouse layer timeout
 #endif
+#ifdef KEYBALL_CLICK_LAYER
+        uint8_t clkd : 1;  // click layer disabled
+        uint8_t clkth : 5; // click layer threshold / 5, 0: default
+#endif
 #if KEYBALL_SCROLLSNAP_ENABLE == 2
         uint8_t ssnap : 2; // scroll snap mode
 #endif
+#ifdef KEYBALL_KINETIC_SCROLL_ENABLE
+        uint8_t kscrl : 3; // kinetic scroll inertia
+#endif
+#if KEYBALL_SENSOR == 3389
+        uint8_t cpi_hi : 1; // bit 7 of cpi, over 12800 CPI
+#endif
+        uint8_t rint : 4; // mouse report interval + 1 (msec), 0: default
     };
 } keyball_config_t;
 
 typedef struct {
-    uint8_t ballcnt; // count of balls: support only 0 or 1, for now
+    uint8_t ballcnt; // count of balls: 0 or 1, which may have several sensors
 } keyball_info_t;
 
 typedef struct {
@@ -145,12 +575,264 @@ typedef struct {
 
 typedef uint8_t keyball_cpi_t;
 
+// keyball_sensor_t is settings of a trackball sensor, sent to the secondary.
+typedef struct {
+    int8_t  angle; // Angle_Tune in degrees
+    bool    snap;  // Angle_Snap is enabled
+    uint8_t lift;  // calibrated lift cutoff, 0: sensor default
+} keyball_sensor_t;
+
+// keyball_calib_t is calibration data of trackball sensors.  It is kept in
+// keyball_store_t, and zero means not calibrated.
+typedef struct {
+    int8_t  angle[2];   // Angle_Tune in degrees: [0] left, [1] right ball
+    uint8_t angle_snap; // Angle_Snap is enabled
+    uint8_t lift[2];    // calibrated lift cutoff: [0] left, [1] right ball
+    uint8_t reserved[3];
+} keyball_calib_t;
+
+// keyball_ball_t is settings of a trackball, kept in keyball_store_t apart
+// from profiles.  Zero in each field means the same as without it.
+typedef struct {
+    uint8_t cpi;   // CPI as keyball_set_cpi(), 0: CPI of the profile
+    uint8_t sdiv;  // scroll divider, 0: scroll divider of the profile
+    uint8_t mode;  // keyball_ball_mode_t
+    uint8_t xform; // bits of keyball_transform_t
+} keyball_ball_t;
+
+#define KEYBALL_PROFILE_COUNT 4
+
+// keyball_store_t is a record of configuration in EEPROM.  Records are
+// written to slots in turn, and the valid one with the latest seq is used.
+// The header is placed at the end to be written last, so a record broken by
+// power loss fails its checksum and the previous one is used.
+typedef struct {
+    uint32_t        profile[KEYBALL_PROFILE_COUNT]; // keyball_config_t
+    uint32_t        user;   // keymap level configuration
+    keyball_calib_t calib;
+    keyball_ball_t  ball[2];    // [0] left, [1] right ball
+    uint8_t         profile_id; // profile applied at startup
+    uint8_t         version;    // KEYBALL_STORE_VERSION, others are empty slots
+    uint8_t         seq;        // sequence number of writes
+    uint8_t         sum;        // checksum of the above
+} keyball_store_t;
+
+#define KEYBALL_STORE_VERSION 1
+
+typedef struct {
+    int16_t  vx;    // smoothed velocity, in 1/16 counts per report
+    int16_t  vy;
+    int8_t   rx;    // residue not yet reported, in 1/16 counts
+    int8_t   ry;
+    uint8_t  speed; // smoothed speed, in counts per report
+    int16_t  dx;    // motion held in the deadband, in counts
+    int16_t  dy;
+    uint32_t held;  // time when the motion started to be held
+} keyball_jitter_t;
+
+typedef struct {
+    int16_t vx;      // velocity, in 1/256 counts per report
+    int16_t vy;
+    int16_t fx;      // fraction not yet emitted, in 1/256 counts
+    int16_t fy;
+    int16_t lx;      // motion left after last report
+    int16_t ly;
+    bool    gliding;
+} keyball_kinetic_t;
+
+// Second byte of raw HID packets for Keyball: command ID.
+enum keyball_hid_command {
+    // Capture a raw frame of the trackball sensor.  Response packets are:
+    // [prefix, command, offset (LE16), length, pixels...].  Offset 0xffff
+    // means an error.
+    KEYBALL_HID_FRAME_CAPTURE = 0x01,
+
+    // Get a parameter.  Request: [prefix, command, param].  Response:
+    // [prefix, command, param, status, value (LE16)].
+    KEYBALL_HID_PARAM_GET = 0x02,
+
+    // Set a parameter.  Request: [prefix, command, param, 0, value (LE16)].
+    // Response is same as KEYBALL_HID_PARAM_GET, with the applied value.
+    KEYBALL_HID_PARAM_SET = 0x03,
+
+    // Save parameters to EEPROM, same as KBC_SAVE.  Response is the request.
+    KEYBALL_HID_PARAM_SAVE = 0x04,
+
+    // Start telemetry.  Request: [prefix, command, interval (LE16, msec)].
+    // Interval 0 stops it.  The request has no response, and packets of
+    // [prefix, command, keyball_telemetry_t] are sent every interval.  Renew
+    // the request within KEYBALL_TELEMETRY_TIMEOUT msec to continue.
+    KEYBALL_HID_TELEMETRY = 0x05,
+};
+
+// keyball_stats_t is statistics of the sensor on the secondary, fetched for
+// telemetry.
+typedef struct {
+    uint16_t polls;   // polls of the sensor, wrapping count
+    uint16_t shutter; // Shutter register
+    uint8_t  squal;   // SQUAL register
+} keyball_stats_t;
+
+// keyball_telemetry_t is a packet of telemetry.  Counts and motions are
+// since the last packet.  "this" is the USB connected half.
+typedef struct {
+    uint8_t  seq;          // sequence number, to detect dropped packets
+    uint8_t  balls : 2;    // bit0 this, bit1 that half has a trackball
+    uint8_t  wake : 6;     // longest gap of polls before the first motion
+                           // after idle on this half, msec up to 63
+    uint16_t time;         // timer_read() when sent, msec
+    uint16_t loops;        // main loop iterations: matrix scans
+    uint16_t polls;        // polls of the sensor on this half
+    uint16_t that_polls;   // polls of the sensor on that half
+    uint16_t reports;      // mouse reports with motion
+    int16_t  this_x;       // raw motion of trackballs, before scroll and
+    int16_t  this_y;       // filters, in sensor counts
+    int16_t  that_x;
+    int16_t  that_y;
+    uint8_t  squal;        // SQUAL (surface quality) of sensors, sampled
+    uint8_t  that_squal;   // when sent
+    uint16_t shutter;      // Shutter of sensors, sampled when sent
+    uint16_t that_shutter;
+    uint16_t link_ok;      // fetches of motion from that half: succeeded
+    uint16_t link_err;     // and failed
+} keyball_telemetry_t;
+
+// keyball_param_t is ID of parameters for tuning.  IDs are a part of the
+// protocol, so don't reorder them.  Values are as the getters return, except
+// noted.
+typedef enum {
+    KEYBALL_PARAM_CPI              = 0,  // keyball_get_cpi
+    KEYBALL_PARAM_SCROLL_DIV       = 1,  // raw value, 0: default
+    KEYBALL_PARAM_SCROLL_MODE      = 2,  // keyball_get_scroll_mode
+    KEYBALL_PARAM_SCROLLSNAP_MODE  = 3,  // keyball_get_scrollsnap_mode
+    KEYBALL_PARAM_KINETIC_SCROLL   = 4,  // keyball_get_kinetic_scroll
+    KEYBALL_PARAM_AML_ENABLE       = 5,  // get_auto_mouse_enable
+    KEYBALL_PARAM_AML_TIMEOUT      = 6,  // get_auto_mouse_timeout: msec
+    KEYBALL_PARAM_ANGLE_LEFT       = 7,  // keyball_get_angle
+    KEYBALL_PARAM_ANGLE_RIGHT      = 8,
+    KEYBALL_PARAM_ANGLE_SNAP       = 9,  // keyball_get_angle_snap
+    KEYBALL_PARAM_LIFT_LEFT        = 10, // keyball_get_lift_cutoff
+    KEYBALL_PARAM_LIFT_RIGHT       = 11,
+    KEYBALL_PARAM_REPORT_INTERVAL  = 12, // keyball_get_report_interval
+    KEYBALL_PARAM_PROFILE          = 13, // keyball_get_profile
+    KEYBALL_PARAM_BALLS            = 14, // read only: bit0 left, bit1 right
+    KEYBALL_PARAM_CLICK_LAYER      = 15, // keyball_get_click_layer
+    KEYBALL_PARAM_CLICK_THRESHOLD  = 16, // keyball_get_click_threshold
+    KEYBALL_PARAM_BALL_CPI_LEFT    = 17, // keyball_get_ball: cpi
+    KEYBALL_PARAM_BALL_CPI_RIGHT   = 18,
+    KEYBALL_PARAM_BALL_SDIV_LEFT   = 19, // keyball_get_ball: sdiv
+    KEYBALL_PARAM_BALL_SDIV_RIGHT  = 20,
+    KEYBALL_PARAM_BALL_MODE_LEFT   = 21, // keyball_get_ball: mode
+    KEYBALL_PARAM_BALL_MODE_RIGHT  = 22,
+    KEYBALL_PARAM_BALL_XFORM_LEFT  = 23, // keyball_get_ball: xform
+    KEYBALL_PARAM_BALL_XFORM_RIGHT = 24,
+    KEYBALL_PARAM_COUNT,
+} keyball_param_t;
+
+// Status of KEYBALL_HID_PARAM_* responses.
+enum keyball_param_status {
+    KEYBALL_PARAM_OK          = 0,
+    KEYBALL_PARAM_UNKNOWN     = 1, // unknown parameter
+    KEYBALL_PARAM_READONLY    = 2, // parameter can't be set
+    KEYBALL_PARAM_UNSUPPORTED = 3, // feature is disabled in this firmware
+};
+
+// keyball_task_t is slow tasks run in slices of the main loop, in order of
+// priority.
+typedef enum {
+    KEYBALL_TASK_RGB,    // keyball_on_task_rgb(), requested by keymaps
+    KEYBALL_TASK_OLED,   // render OLED
+    KEYBALL_TASK_EEPROM, // write configuration to EEPROM
+    KEYBALL_TASK_COUNT,
+} keyball_task_t;
+
+// keyball_led_t is a LED of RGB_MATRIX on a PCB of a half, listed in order of
+// the LED chain.  x is the distance from the inner edge of the half (0-112),
+// and y is from the top (0-64).
+typedef struct {
+    uint8_t key; // row << 4 | col in the half, or KEYBALL_LED_NOKEY
+    uint8_t x;
+    uint8_t y;
+    uint8_t flags;
+} keyball_led_t;
+
+#define KEYBALL_LED_NOKEY 0xff
+
+#define KEYBALL_LED_KEY(row, col, x, y) \
+    { (row) << 4 | (col), (x), (y), LED_FLAG_KEYLIGHT }
+#define KEYBALL_LED_UNDER(x, y) \
+    { KEYBALL_LED_NOKEY, (x), (y), LED_FLAG_UNDERGLOW }
+
+// keyball_ball_mode_t is the mode of a trackball out of scroll mode.  Scroll
+// mode swaps pointer and scroll of all trackballs.
+typedef enum {
+    KEYBALL_BALL_AUTO    = 0, // pointer on the primary, or scroll on the
+                              // secondary when both halves have a trackball
+    KEYBALL_BALL_POINTER = 1,
+    KEYBALL_BALL_SCROLL  = 2,
+    KEYBALL_BALL_MODE_COUNT,
+} keyball_ball_mode_t;
+
+// keyball_transform_t is bits of transform of motion of a trackball, applied
+// to the pointer or scroll: swap at first, then invert.
+typedef enum {
+    KEYBALL_TRANSFORM_INVERT_X = 0x01, // invert horizontal motion
+    KEYBALL_TRANSFORM_INVERT_Y = 0x02, // invert vertical motion
+    KEYBALL_TRANSFORM_SWAP_XY  = 0x04, // swap horizontal and vertical motion
+    KEYBALL_TRANSFORM_ALL      = 0x07,
+} keyball_transform_t;
+
+// keyball_keys_t is a set of keycodes for key mode of a trackball.
+typedef enum {
+    KEYBALL_KEYS_NONE   = 0, // key mode is off
+    KEYBALL_KEYS_ARROW  = 1, // arrow keys
+    KEYBALL_KEYS_PAGE   = 2, // page up and down, home and end
+    KEYBALL_KEYS_VOLUME = 3, // volume up and down, previous and next track
+    KEYBALL_KEYS_COUNT,
+} keyball_keys_t;
+
+// keyball_gesture_t is direction of a gesture, clockwise from up.
+typedef enum {
+    KEYBALL_GESTURE_UP         = 0,
+    KEYBALL_GESTURE_UP_RIGHT   = 1,
+    KEYBALL_GESTURE_RIGHT      = 2,
+    KEYBALL_GESTURE_DOWN_RIGHT = 3,
+    KEYBALL_GESTURE_DOWN       = 4,
+    KEYBALL_GESTURE_DOWN_LEFT  = 5,
+    KEYBALL_GESTURE_LEFT       = 6,
+    KEYBALL_GESTURE_UP_LEFT    = 7,
+    KEYBALL_GESTURE_COUNT,
+} keyball_gesture_t;
+
+// keyball_dual_gesture_t is a step, start or end of gestures by both
+// trackballs.
+typedef enum {
+    KEYBALL_DUAL_GESTURE_ZOOM_IN      = 0, // trackballs are rolled apart
+    KEYBALL_DUAL_GESTURE_ZOOM_OUT     = 1, // trackballs are rolled together
+    KEYBALL_DUAL_GESTURE_ROTATE_CW    = 2, // left is rolled up, right down
+    KEYBALL_DUAL_GESTURE_ROTATE_CCW   = 3, // left is rolled down, right up
+    KEYBALL_DUAL_GESTURE_ZOOM_START   = 4, // before the first step of zoom
+    KEYBALL_DUAL_GESTURE_ZOOM_END     = 5, // after the last step of zoom
+    KEYBALL_DUAL_GESTURE_ROTATE_START = 6,
+    KEYBALL_DUAL_GESTURE_ROTATE_END   = 7,
+} keyball_dual_gesture_t;
+
 typedef enum {
     KEYBALL_SCROLLSNAP_MODE_VERTICAL   = 0,
     KEYBALL_SCROLLSNAP_MODE_HORIZONTAL = 1,
     KEYBALL_SCROLLSNAP_MODE_FREE       = 2,
+    KEYBALL_SCROLLSNAP_MODE_AUTO       = 3,
 } keyball_scrollsnap_mode_t;
 
+// keyball_scrollsnap_auto_t is states of KEYBALL_SCROLLSNAP_MODE_AUTO for a
+// trackball.
+typedef struct {
+    keyball_scrollsnap_mode_t dir; // FREE: not determined
+    uint32_t                  last;
+    int16_t                   tension;
+    keyball_motion_t          rest;
+} keyball_scrollsnap_auto_t;
+
 typedef struct {
     bool this_have_ball;
     bool that_enable;
@@ -159,8 +841,34 @@ typedef struct {
     keyball_motion_t this_motion;
     keyball_motion_t that_motion;
 
+#ifdef KEYBALL_JITTER_FILTER_ENABLE
+    keyball_jitter_t this_jitter;
+    keyball_jitter_t that_jitter;
+#endif
+
+#ifdef KEYBALL_KINETIC_SCROLL_ENABLE
+    uint8_t           kinetic_level;
+    keyball_kinetic_t this_kinetic;
+    keyball_kinetic_t that_kinetic;
+#endif
+
+    keyball_ball_t ball[2]; // [0] left, [1] right ball
+
     uint8_t cpi_value;
     bool    cpi_changed;
+    uint8_t report_interval; // msec, 0: not throttled
+    uint8_t profile;         // active profile
+
+#ifdef KEYBALL_CLICK_LAYER
+    bool    click_enable;
+    uint8_t click_threshold; // |x| + |y| counts
+#endif
+
+    keyball_calib_t calib;
+    bool            sensor_changed;
+    bool            angle_cal;   // angle calibration is in progress
+    uint8_t         lift_cal;    // sides in lift cutoff calibration: bit0 this, bit1 that
+    uint32_t        cal_started;
 
     bool     scroll_mode;
     uint32_t scroll_mode_changed;
@@ -171,11 +879,17 @@ typedef struct {
     int8_t   scroll_snap_tension_h;
 #elif KEYBALL_SCROLLSNAP_ENABLE == 2
     keyball_scrollsnap_mode_t scrollsnap_mode;
+
+    keyball_scrollsnap_auto_t scrollsnap_auto[2]; // [0] left, [1] right ball
 #endif
 
     uint16_t       last_kc;
     keypos_t       last_pos;
     report_mouse_t last_mouse;
+    uint32_t       last_moved; // time when last_mouse had motion
+#ifdef KEYBALL_RGB_MOTION_ENABLE
+    uint8_t motion_peak; // peak speed of trackballs since last RGB update
+#endif
 
     // Buffer to indicate pressing keys.
     char pressing_keys[KEYBALL_OLED_MAX_PRESSING_KEYCODES + 1];
@@ -208,6 +922,32 @@ void keyball_on_apply_motion_to_mouse_move(keyball_motion_t *m, report_mouse_t *
 /// You can change the default algorithm by override this function.
 void keyball_on_apply_motion_to_mouse_scroll(keyball_motion_t *m, report_mouse_t *r, bool is_left);
 
+/// keyball_on_gesture is called when a gesture is input in gesture mode.
+/// The default sends a keycode of KEYBALL_GESTURE_KEYCODES by tap_code16().
+/// You can send other keycodes or run actions by override this function.
+void keyball_on_gesture(keyball_gesture_t gesture);
+
+/// keyball_on_dual_gesture is called for each step of a dual gesture, and at
+/// its start and end, with mouse report r to be sent.  The default holds
+/// KEYBALL_DUAL_GESTURE_ZOOM_MODS from the start to the end of zoom, only ones
+/// not held already, zooms by wheel of r, and rotates by
+/// KEYBALL_DUAL_GESTURE_ROTATE_KEYCODES.
+/// You can send other keycodes or run actions by override this function.
+void keyball_on_dual_gesture(keyball_dual_gesture_t gesture, report_mouse_t *r);
+
+/// keyball_on_task_rgb is called in a slice of the main loop after
+/// keyball_request_task(KEYBALL_TASK_RGB), to update RGB LEDs without delaying
+/// trackballs.  Return true to be called again in the next slice, to split
+/// long work into slices.
+bool keyball_on_task_rgb(void);
+
+/// keyball_on_raw_hid_receive is called for raw HID packets which are not for
+/// Keyball, when Keyball defines raw_hid_receive() for KEYBALL_FRAME_CAPTURE_ENABLE,
+/// KEYBALL_TUNING_ENABLE or KEYBALL_TELEMETRY_ENABLE without VIA.  Keymaps
+/// implement this instead of raw_hid_receive().  Return true when the packet
+/// is handled, otherwise it is replied as unhandled.
+bool keyball_on_raw_hid_receive(uint8_t *data, uint8_t length);
+
 //////////////////////////////////////////////////////////////////////////////
 // Public API functions
 
@@ -224,18 +964,64 @@ void keyball_oled_render_keyinfo(void);
 /// inactive layers.
 void keyball_oled_render_layerinfo(void);
 
+/// keyball_oled_render_*() rewrite only cells whose values have changed since
+/// the last call, assuming their positions on OLED are kept.
+/// keyball_oled_invalidate makes them render all cells on the next call.  Call
+/// it after the OLED was cleared, or the panes were moved or overwritten.
+void keyball_oled_invalidate(void);
+
+/// keyball_led_map_apply sets g_led_config of RGB_MATRIX for LEDs of a half
+/// from map in PROGMEM, which has count LEDs of the PCB of the half.  LEDs in
+/// RGB_MATRIX_SPLIT beyond count are left dark, because PCBs of ball side have
+/// less LEDs than no ball side.  Call it from keyball_on_adjust_layout.
+void keyball_led_map_apply(bool is_left, const keyball_led_t *map, uint8_t count);
+
 /// keyball_get_scroll_mode gets current scroll mode.
 bool keyball_get_scroll_mode(void);
 
 /// keyball_set_scroll_mode modify scroll mode.
 void keyball_set_scroll_mode(bool mode);
 
+/// keyball_get_gesture_mode gets current gesture mode.
+bool keyball_get_gesture_mode(void);
+
+/// keyball_set_gesture_mode modify gesture mode.  In gesture mode, motion of
+/// trackballs is input as gestures instead of moving the pointer or
+/// scrolling.  This works only when KEYBALL_GESTURE_ENABLE is defined.
+void keyball_set_gesture_mode(bool mode);
+
+/// keyball_get_key_mode gets the key set of key mode of the trackball at the
+/// side, including one selected by KEYBALL_KEY_MODE_LAYERS.
+keyball_keys_t keyball_get_key_mode(bool is_left);
+
+/// keyball_set_key_mode selects key mode of the trackball at the side: its
+/// motion is quantized per KEYBALL_KEY_MODE_THRESHOLD_X and _Y counts, and
+/// sent as taps of the keys along the major axis.  KEYBALL_KEYS_NONE returns
+/// it to pointer or scroll.  This works only when KEYBALL_KEY_MODE_ENABLE is
+/// defined.
+void keyball_set_key_mode(bool is_left, keyball_keys_t mode);
+
 /// keyball_get_scrollsnap_mode gets current scroll snap mode.
 keyball_scrollsnap_mode_t keyball_get_scrollsnap_mode(void);
 
 /// keyball_set_scrollsnap_mode change scroll snap mode.
 void keyball_set_scrollsnap_mode(keyball_scrollsnap_mode_t mode);
 
+/// keyball_get_kinetic_scroll gets current level of kinetic scroll inertia.
+/// See also keyball_set_kinetic_scroll for the level's detail.
+uint8_t keyball_get_kinetic_scroll(void);
+
+/// keyball_set_kinetic_scroll changes level of kinetic scroll inertia.
+///
+/// When the ball is released at speed in scroll mode, scroll continues and
+/// its speed decays on each mouse report by the factor:
+///
+///     decay = 1 - 1 / 2 ^ (level + 1)
+///
+/// Valid values are between 0 and 6, 0 disables kinetic scroll.  This works
+/// only when KEYBALL_KINETIC_SCROLL_ENABLE is defined.
+void keyball_set_kinetic_scroll(uint8_t level);
+
 /// keyball_get_scroll_div gets current scroll divider.
 /// See also keyball_set_scroll_div for the scroll divider's detail.
 uint8_t keyball_get_scroll_div(void);
@@ -255,6 +1041,47 @@ uint8_t keyball_get_scroll_div(void);
 /// is specified.
 void keyball_set_scroll_div(uint8_t div);
 
+/// keyball_calibrate_angle starts angle calibration of trackballs.
+///
+/// Roll a trackball straight up (the pointer moves up) after this, then the
+/// skew angle of its sensor is measured and saved to EEPROM.  It finishes
+/// after KEYBALL_ANGLE_CAL_DISTANCE counts of motion, or is aborted after
+/// KEYBALL_ANGLE_CAL_TIMEOUT msec.  While calibrating, no motion is reported.
+void keyball_calibrate_angle(void);
+
+/// keyball_get_angle gets Angle_Tune of the trackball at the side in degrees.
+int8_t keyball_get_angle(bool is_left);
+
+/// keyball_set_angle changes Angle_Tune of the trackball at the side.  The
+/// sensor rotates motion by the angle in degrees, clockwise for positive
+/// values.  Valid values are between -30 and 30.
+void keyball_set_angle(bool is_left, int8_t angle);
+
+/// keyball_get_angle_snap gets Angle_Snap of trackballs is enabled or not.
+bool keyball_get_angle_snap(void);
+
+/// keyball_set_angle_snap enables or disables Angle_Snap of trackballs.  The
+/// sensors snap nearly horizontal or vertical motion to the axis.
+void keyball_set_angle_snap(bool enable);
+
+/// keyball_calibrate_lift starts lift cutoff calibration of trackball sensors.
+///
+/// Roll trackballs around in various directions after this, until the sensors
+/// finish the calibration.  The results are saved to EEPROM, and reduce
+/// phantom motion when the trackball is lifted or bumped.  It is aborted after
+/// KEYBALL_LIFT_CAL_TIMEOUT msec.  While calibrating, no motion is reported.
+/// This works only when SROM is uploaded: see KEYBALL_PMW3360_UPLOAD_SROM_ID
+/// and KEYBALL_PMW3389_UPLOAD_SROM.
+void keyball_calibrate_lift(void);
+
+/// keyball_get_lift_cutoff gets calibrated lift cutoff value of the trackball
+/// at the side.  0 means the sensor default.
+uint8_t keyball_get_lift_cutoff(bool is_left);
+
+/// keyball_set_lift_cutoff changes lift cutoff value of the trackball at the
+/// side.  Specify 0 to use the sensor default.
+void keyball_set_lift_cutoff(bool is_left, uint8_t value);
+
 /// keyball_get_cpi gets current CPI of trackball.
 /// The actual CPI value is the returned value +1 and multiplied by 100:
 ///
@@ -262,11 +1089,82 @@ void keyball_set_scroll_div(uint8_t div);
 uint8_t keyball_get_cpi(void);
 
 /// keyball_set_cpi changes CPI of trackball.
-/// Valid values are between 0 to 119, and the actual CPI value is the set
-/// value +1 and multiplied by 100:
+/// Valid values are between 0 to the maximum of the sensor: 119 for PMW3360,
+/// 159 for PMW3389 or 31 for PMW3610.  The actual CPI value is the set value
+/// +1 and multiplied by 100, and rounded to the resolution of the sensor:
 ///
 ///     CPI = (v + 1) * 100
 ///
-/// In addition, if you do not upload SROM, the maximum value will be limited
-/// to 34 (3500CPI).
+/// In addition, if you do not upload SROM to PMW3360, the maximum value will
+/// be limited to 34 (3500CPI).
 void keyball_set_cpi(uint8_t cpi);
+
+/// keyball_get_ball gets settings of the trackball at the side.
+keyball_ball_t keyball_get_ball(bool is_left);
+
+/// keyball_set_ball changes settings of the trackball at the side: its own
+/// CPI and scroll divider instead of ones of the profile, its mode, and
+/// transform of its motion.  A scroll ball can run at low CPI, which reduces
+/// counts dropped by the scroll divider and motion sent between halves.  They
+/// are shared by all profiles, and saved by KBC_SAVE.
+void keyball_set_ball(bool is_left, keyball_ball_t ball);
+
+/// keyball_get_sensor_motion gets motion of a sensor of this half by index of
+/// PMW33XX_NCS_PINS, read at the last poll.  It is zero while the sensor
+/// doesn't move or is not present.  Call this from pointing_device_task_user()
+/// or housekeeping_task_user(), to use motion of additional sensors.
+keyball_motion_t keyball_get_sensor_motion(uint8_t index);
+
+/// keyball_get_report_interval gets current interval of mouse reports in
+/// msec.
+uint8_t keyball_get_report_interval(void);
+
+/// keyball_set_report_interval changes interval of mouse reports.  Valid
+/// values are between 0 and 14 msec, 0 reports on every scan.  It starts with
+/// KEYBALL_REPORTMOUSE_INTERVAL, and is kept in profiles.
+void keyball_set_report_interval(uint8_t msec);
+
+/// keyball_get_click_layer gets the click layer is enabled or not.
+bool keyball_get_click_layer(void);
+
+/// keyball_set_click_layer enables or disables the click layer.  Disabling
+/// turns off the layer.  This works only when KEYBALL_CLICK_LAYER is defined.
+void keyball_set_click_layer(bool enable);
+
+/// keyball_get_click_threshold gets motion (|x| + |y| counts of the pointer)
+/// to turn on the click layer.
+uint8_t keyball_get_click_threshold(void);
+
+/// keyball_set_click_threshold changes motion to turn on the click layer.
+/// Valid values are between 5 and 155, and rounded down to a multiple of 5 as
+/// kept in profiles.
+void keyball_set_click_threshold(uint8_t counts);
+
+/// keyball_get_profile gets the active profile.
+uint8_t keyball_get_profile(void);
+
+/// keyball_set_profile applies a stored profile: CPI, scroll divider, scroll
+/// snap mode, kinetic scroll, automatic mouse layer or click layer and report
+/// interval at once, with one write to the sensor and one sync to the other
+/// half.  Valid values are between 0 and KEYBALL_PROFILE_COUNT - 1.  Changes
+/// to the active profile are lost on switching unless saved by KBC_SAVE, which
+/// also makes the active profile the one at startup.  Switching doesn't write
+/// EEPROM.
+void keyball_set_profile(uint8_t id);
+
+/// keyball_store_read_user gets keymap level configuration kept with Keyball's
+/// configuration in EEPROM.  It is 0 until updated.
+uint32_t keyball_store_read_user(void);
+
+/// keyball_store_update_user updates keymap level configuration.  It is
+/// written to EEPROM lazily, so this can be called on every key press unlike
+/// eeconfig_update_user().
+void keyball_store_update_user(uint32_t value);
+
+/// keyball_save saves configuration to EEPROM, same as KBC_SAVE.  It is
+/// written to EEPROM lazily too.
+void keyball_save(void);
+
+/// keyball_request_task requests to run a slow task in a slice of the main
+/// loop.  The task runs once even if requested several times before it.
+void keyball_request_task(keyball_task_t task);
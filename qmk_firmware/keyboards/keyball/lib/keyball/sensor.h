@@ -0,0 +1,319 @@
+/*
+Copyright 2022 MURAOKA Taro (aka KoRoN, @kaoriya)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// Trackball sensor interface for Keyball, resolved at compile time by
+// KEYBALL_SENSOR.  Functions are static inline to call a driver directly,
+// without function pointers.
+//
+// CPI is specified in 100 CPI steps for all sensors: the actual CPI is
+// (cpi + 1) * 100, and it is rounded to the resolution of the sensor.
+// Unsupported features of a sensor are no-op, and their constants are 0.
+//
+// A half may have SENSOR_COUNT sensors on one SPI bus: only PMW3360 and
+// PMW3389 support several of them, with PMW33XX_NCS_PINS.  Settings are
+// written to all present sensors, and motion is read from all of them back to
+// back.  Calibration, frame capture and quality read use the primary sensor:
+// the first present one.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef KEYBALL_SENSOR
+#    define KEYBALL_SENSOR 3360
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+// PMW3360 and PMW3389, which share a driver
+
+#if KEYBALL_SENSOR == 3360 || KEYBALL_SENSOR == 3389
+
+#    ifndef PMW33XX_MODEL
+#        define PMW33XX_MODEL KEYBALL_SENSOR
+#    endif
+#    include "drivers/pmw33xx/pmw33xx.h"
+
+#    if KEYBALL_SENSOR == 3360
+#        define SENSOR_CPI_MAX (pmw33xx_MAXCPI + 1)
+#    else
+#        define SENSOR_CPI_MAX ((pmw33xx_MAXCPI + 1) / 2)
+#    endif
+#    define SENSOR_MAXANGLE pmw33xx_MAXANGLE
+#    define SENSOR_FRAME_SIZE pmw33xx_FRAME_SIZE
+#    define SENSOR_HAS_FRAME 1
+#    define SENSOR_HAS_REST 1
+#    define SENSOR_COUNT PMW33XX_COUNT
+
+typedef pmw33xx_motion_t sensor_motion_t;
+typedef pmw33xx_rest_t   sensor_rest_t;
+
+// sensor_primary returns index of the primary sensor: the first present one,
+// or 0 when none is present.
+static inline uint8_t sensor_primary(void) {
+    for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+        if (pmw33xx_present & (1 << i)) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+// sensor_select selects a sensor by index, and returns true when it is
+// present.  Functions below select the primary sensor again at last.
+static inline bool sensor_select(uint8_t i) {
+    pmw33xx_select(i);
+    return (pmw33xx_present & (1 << i)) != 0;
+}
+
+// sensor_init initializes all sensors, and returns true when any of them
+// responded.
+static inline bool sensor_init(void) {
+    for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+        pmw33xx_select(i);
+        pmw33xx_init();
+    }
+    pmw33xx_select(sensor_primary());
+    return pmw33xx_present != 0;
+}
+
+// sensor_present returns bit mask of present sensors.
+static inline uint8_t sensor_present(void) {
+    return pmw33xx_present;
+}
+
+static inline void sensor_srom_upload(void) {
+#    if KEYBALL_SENSOR == 3389 && KEYBALL_PMW3389_UPLOAD_SROM
+    for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+        if (sensor_select(i)) {
+            pmw33xx_srom_upload(pmw33xx_srom_3389);
+        }
+    }
+    pmw33xx_select(sensor_primary());
+#    elif KEYBALL_SENSOR == 3360 && defined(KEYBALL_PMW3360_UPLOAD_SROM_ID)
+    for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+        if (!sensor_select(i)) {
+            continue;
+        }
+#        if KEYBALL_PMW3360_UPLOAD_SROM_ID == 0x04
+        pmw33xx_srom_upload(pmw33xx_srom_0x04);
+#        elif KEYBALL_PMW3360_UPLOAD_SROM_ID == 0x81
+        pmw33xx_srom_upload(pmw33xx_srom_0x81);
+#        else
+#            error Invalid value for KEYBALL_PMW3360_UPLOAD_SROM_ID. Please choose 0x04 or 0x81 or disable it.
+#        endif
+    }
+    pmw33xx_select(sensor_primary());
+#    endif
+}
+
+static inline bool sensor_verify(void) {
+    bool ok = true;
+    for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+        if (sensor_select(i) && !pmw33xx_verify()) {
+            ok = false;
+        }
+    }
+    pmw33xx_select(sensor_primary());
+    return ok;
+}
+
+// sensor_recover recovers sensors which fail to verify.
+static inline bool sensor_recover(void) {
+    bool ok = true;
+    for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+        if (sensor_select(i) && !pmw33xx_verify() && !pmw33xx_recover()) {
+            ok = false;
+        }
+    }
+    pmw33xx_select(sensor_primary());
+    return ok;
+}
+
+// sensor_motion_burst_all reads motion of all sensors back to back into d,
+// by index.  It returns bit mask of sensors which have motion.
+static inline uint8_t sensor_motion_burst_all(sensor_motion_t *d) {
+    uint8_t mot = 0;
+    for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+        if (sensor_select(i) && pmw33xx_motion_burst(&d[i])) {
+            mot |= 1 << i;
+        }
+    }
+    pmw33xx_select(sensor_primary());
+    return mot;
+}
+
+static inline void sensor_cpi_set(uint8_t cpi) {
+    for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+        if (sensor_select(i)) {
+#    if KEYBALL_SENSOR == 3360
+            pmw33xx_cpi_set(cpi);
+#    else
+            // 50 CPI steps
+            pmw33xx_cpi_set((uint16_t)cpi * 2 + 1);
+#    endif
+        }
+    }
+    pmw33xx_select(sensor_primary());
+}
+
+static inline void sensor_rest_set(const sensor_rest_t *r) {
+    for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+        if (sensor_select(i)) {
+            pmw33xx_rest_set(r);
+        }
+    }
+    pmw33xx_select(sensor_primary());
+}
+
+static inline bool sensor_lift_cal_start(void) {
+#    if KEYBALL_SENSOR == 3389 && !KEYBALL_PMW3389_UPLOAD_SROM
+    // lift cutoff calibration requires SROM.
+    return false;
+#    else
+    return pmw33xx_lift_cal_start();
+#    endif
+}
+
+static inline int16_t sensor_lift_cal_poll(void) {
+    return pmw33xx_lift_cal_poll();
+}
+
+static inline void sensor_lift_cutoff_set(uint8_t value) {
+    for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+        if (sensor_select(i)) {
+            pmw33xx_lift_cutoff_set(value);
+        }
+    }
+    pmw33xx_select(sensor_primary());
+}
+
+static inline void sensor_angle_tune_set(int8_t angle) {
+    for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+        if (sensor_select(i)) {
+            pmw33xx_angle_tune_set(angle);
+        }
+    }
+    pmw33xx_select(sensor_primary());
+}
+
+static inline void sensor_angle_snap_set(bool enable) {
+    for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+        if (sensor_select(i)) {
+            pmw33xx_angle_snap_set(enable);
+        }
+    }
+    pmw33xx_select(sensor_primary());
+}
+
+static inline void sensor_frame_begin(void) {
+    pmw33xx_frame_begin();
+}
+
+static inline void sensor_frame_read(uint8_t *buf, uint16_t len) {
+    pmw33xx_frame_read(buf, len);
+}
+
+static inline void sensor_frame_end(void) {
+    pmw33xx_frame_end();
+}
+
+static inline void sensor_quality_read(uint8_t *squal, uint16_t *shutter) {
+    pmw33xx_quality_read(squal, shutter);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// PMW3610
+
+#elif KEYBALL_SENSOR == 3610
+
+#    include "drivers/pmw3610/pmw3610.h"
+
+#    define SENSOR_CPI_MAX ((pmw3610_MAXCPI + 1) * 2)
+#    define SENSOR_MAXANGLE 0
+#    define SENSOR_FRAME_SIZE 0
+#    define SENSOR_HAS_FRAME 0
+#    define SENSOR_HAS_REST 0
+#    define SENSOR_COUNT 1
+
+typedef pmw3610_motion_t sensor_motion_t;
+
+// PMW3610 enters rest modes by itself.
+typedef struct {
+    uint8_t unused;
+} sensor_rest_t;
+
+static inline bool sensor_init(void) {
+    return pmw3610_init();
+}
+
+static inline uint8_t sensor_present(void) {
+    return 1;
+}
+
+static inline uint8_t sensor_primary(void) {
+    return 0;
+}
+
+static inline void sensor_srom_upload(void) {}
+
+static inline bool sensor_verify(void) {
+    return pmw3610_verify();
+}
+
+static inline bool sensor_recover(void) {
+    return pmw3610_recover();
+}
+
+static inline uint8_t sensor_motion_burst_all(sensor_motion_t *d) {
+    return pmw3610_motion_burst(d) ? 1 : 0;
+}
+
+static inline void sensor_cpi_set(uint8_t cpi) {
+    // 200 CPI steps
+    pmw3610_cpi_set(cpi / 2);
+}
+
+static inline void sensor_rest_set(const sensor_rest_t *r) {}
+
+static inline bool sensor_lift_cal_start(void) {
+    return false;
+}
+
+static inline int16_t sensor_lift_cal_poll(void) {
+    return 0;
+}
+
+static inline void sensor_lift_cutoff_set(uint8_t value) {}
+
+static inline void sensor_angle_tune_set(int8_t angle) {}
+
+static inline void sensor_angle_snap_set(bool enable) {}
+
+static inline void sensor_frame_begin(void) {}
+
+static inline void sensor_frame_read(uint8_t *buf, uint16_t len) {}
+
+static inline void sensor_frame_end(void) {}
+
+static inline void sensor_quality_read(uint8_t *squal, uint16_t *shutter) {
+    pmw3610_quality_read(squal, shutter);
+}
+
+#else
+#    error Invalid value for KEYBALL_SENSOR. Please choose 3360, 3389 or 3610.
+#endif
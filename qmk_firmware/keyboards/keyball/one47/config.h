@@ -26,6 +26,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define MATRIX_MASKED
 #define DEBOUNCE            5
 
+// Keyball keeps its configuration (keyball_store_t, 40 bytes) in the
+// keyboard level data block of EEPROM.  It has 3 slots for wear leveling.
+#define EECONFIG_KB_DATA_SIZE 128
+
 // RGB LED settings
 #define WS2812_DI_PIN       D3
 #ifdef RGBLIGHT_ENABLE
@@ -34,3 +34,6 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #endif
 
 #define TAP_CODE_DELAY 5
+
+// serve parameters of Keyball to custom menus of VIA.
+#define KEYBALL_TUNING_ENABLE
@@ -4,6 +4,9 @@ MCU = atmega32u4
 # Bootloader selection
 BOOTLOADER = caterina
 
+# ProMicro pin compatible: build for RP2040 with CONVERT_TO=promicro_rp2040.
+PIN_COMPATIBLE = promicro
+
 # Link Time Optimization required for size.
 LTO_ENABLE = yes
 
@@ -26,7 +29,7 @@ SPLIT_KEYBOARD = no
 # Optical sensor driver for trackball.
 POINTING_DEVICE_ENABLE = yes
 POINTING_DEVICE_DRIVER = custom
-SRC += drivers/pmw3360/pmw3360.c
+# Its driver is selected by KEYBALL_SENSOR, see ../post_rules.mk
 QUANTUM_LIB_SRC += spi_master.c # Optical sensor use SPI to communicate
 
 # This is unnecessary for processing KC_MS_BTN*.
@@ -0,0 +1,14 @@
+# Optical sensor of trackball: 3360 (PMW3360, default), 3389 (PMW3389) or
+# 3610 (PMW3610).  Set KEYBALL_SENSOR in rules.mk of your keymap to change it.
+KEYBALL_SENSOR ?= 3360
+ifeq ($(filter $(KEYBALL_SENSOR),3360 3389 3610),)
+    $(error KEYBALL_SENSOR="$(KEYBALL_SENSOR)" is not supported, please choose 3360, 3389 or 3610)
+endif
+ifneq ($(filter $(KEYBALL_SENSOR),3360 3389),)
+    # PMW3360 and PMW3389 share a driver.
+    SRC += drivers/pmw33xx/pmw33xx.c
+    OPT_DEFS += -DPMW33XX_MODEL=$(KEYBALL_SENSOR)
+else
+    SRC += drivers/pmw$(KEYBALL_SENSOR)/pmw$(KEYBALL_SENSOR).c
+endif
+OPT_DEFS += -DKEYBALL_SENSOR=$(KEYBALL_SENSOR)